@@ -0,0 +1,434 @@
+#pragma once
+
+// Small benchmark harness shared by the perf samples (trie-perf, searchers, filters).
+// Every benchmark runs a few untimed warm-up rounds and then N timed runs,
+// reported as median/p95/stddev. On Linux it can also collect hardware counters
+// with perf_event_open. The results can be saved as CSV or JSON, so runs of
+// different builds can be compared.
+//
+// Command line switches, removed from argv by bench::Configure():
+//   --bench-runs=N      timed runs per benchmark (default 5)
+//   --bench-warmup=N    untimed runs before measuring (default 1)
+//   --bench-counters    cycles, instructions, cache misses, branch misses (Linux)
+//   --bench-csv=file    write all results as CSV
+//   --bench-json=file   write all results as JSON
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// from https://stackoverflow.com/questions/33975479/escape-and-clobber-equivalent-in-msvc
+/**
+ * Call doNotOptimizeAway(var) against variables that you use for
+ * benchmarking but otherwise are useless. The compiler tends to do a
+ * good job at eliminating unused variables, and this function fools
+ * it into thinking var is in fact needed.
+ */
+#ifdef _MSC_VER
+
+#pragma optimize("", off)
+
+template <class T>
+void DoNotOptimizeAway(T&& datum) {
+	datum = datum;
+}
+
+#pragma optimize("", on)
+
+#elif defined(__clang__)
+
+template <class T>
+__attribute__((__optnone__)) void DoNotOptimizeAway(T&& /* datum */) {}
+
+#else
+
+template <class T>
+void DoNotOptimizeAway(T&& datum) {
+	asm volatile("" : "+r" (datum));
+}
+
+#endif
+
+namespace bench {
+
+	struct Options {
+		size_t warmupRuns{ 1 };
+		size_t runs{ 5 };
+		bool counters{ false };
+		std::string csvPath;
+		std::string jsonPath;
+	};
+
+	enum class Counter { Cycles, Instructions, CacheMisses, BranchMisses, Count };
+
+	inline constexpr std::array<const char*, static_cast<size_t>(Counter::Count)> CounterNames{
+		"cycles", "instructions", "cache_misses", "branch_misses"
+	};
+
+	using CounterValues = std::array<uint64_t, static_cast<size_t>(Counter::Count)>;
+
+	struct Result {
+		std::string name;
+		std::vector<double> timesMs; // one entry per timed run
+		double minMs{ 0.0 };
+		double medianMs{ 0.0 };
+		double p95Ms{ 0.0 };
+		double meanMs{ 0.0 };
+		double stddevMs{ 0.0 };
+		bool hasCounters{ false };
+		CounterValues counters{}; // median per run
+		std::string ret; // value returned by the benchmark, as text
+	};
+
+	// Hardware counters of the calling thread, opened as one group so all of
+	// them cover exactly the same instructions. Threads started by the measured
+	// code are not counted.
+	class PerfCounters {
+	public:
+		PerfCounters() {
+#ifdef __linux__
+			constexpr std::array<uint64_t, static_cast<size_t>(Counter::Count)> configs{
+				PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+			};
+			for (size_t i = 0; i < configs.size(); ++i) {
+				perf_event_attr attr{};
+				attr.size = sizeof(attr);
+				attr.type = PERF_TYPE_HARDWARE;
+				attr.config = configs[i];
+				attr.disabled = i == 0 ? 1 : 0; // the leader starts and stops the whole group
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+				fds[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], PERF_FLAG_FD_CLOEXEC));
+				if (fds[i] < 0) {
+					Close();
+					return;
+				}
+			}
+#endif
+		}
+
+		~PerfCounters() { Close(); }
+
+		PerfCounters(const PerfCounters&) = delete;
+		PerfCounters& operator=(const PerfCounters&) = delete;
+
+		bool Valid() const noexcept { return fds[0] >= 0; }
+
+		void Start() noexcept {
+#ifdef __linux__
+			::ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			::ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+		}
+
+		CounterValues Stop() noexcept {
+			CounterValues values{};
+#ifdef __linux__
+			::ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+			struct {
+				uint64_t nr;
+				uint64_t timeEnabled;
+				uint64_t timeRunning;
+				uint64_t values[static_cast<size_t>(Counter::Count)];
+			} data{};
+			if (::read(fds[0], &data, sizeof(data)) < static_cast<ssize_t>(sizeof(data)) || data.timeRunning == 0)
+				return values;
+
+			// the kernel multiplexes counters when there are not enough of them, scale to the whole run
+			const double scale = static_cast<double>(data.timeEnabled) / static_cast<double>(data.timeRunning);
+			for (size_t i = 0; i < values.size(); ++i)
+				values[i] = static_cast<uint64_t>(static_cast<double>(data.values[i]) * scale);
+#endif
+			return values;
+		}
+
+	private:
+		void Close() noexcept {
+#ifdef __linux__
+			for (auto& fd : fds) {
+				if (fd >= 0)
+					::close(fd);
+				fd = -1;
+			}
+#endif
+		}
+
+		std::array<int, static_cast<size_t>(Counter::Count)> fds{ -1, -1, -1, -1 };
+	};
+
+	namespace detail {
+		inline double Percentile(const std::vector<double>& sorted, double p) {
+			// nearest rank
+			const auto rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+			return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+		}
+
+		template <typename T>
+		std::string ToText(const T& value) {
+			if constexpr (requires(std::ostream& os) { os << value; }) {
+				std::ostringstream os;
+				os << value;
+				return os.str();
+			}
+			else
+				return {};
+		}
+
+		inline std::string CsvQuoted(std::string_view text) {
+			std::string out{ "\"" };
+			for (const auto ch : text) {
+				if (ch == '"')
+					out.push_back('"');
+				out.push_back(ch);
+			}
+			out.push_back('"');
+			return out;
+		}
+
+		inline std::string JsonQuoted(std::string_view text) {
+			std::string out{ "\"" };
+			for (const auto ch : text) {
+				if (ch == '"' || ch == '\\')
+					out.push_back('\\');
+				if (static_cast<unsigned char>(ch) < 0x20) {
+					char buf[8];
+					std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(ch));
+					out += buf;
+				}
+				else
+					out.push_back(ch);
+			}
+			out.push_back('"');
+			return out;
+		}
+	}
+
+	class Runner {
+	public:
+		explicit Runner(Options opts = {}) : options(std::move(opts)) { }
+
+		const Options& GetOptions() const noexcept { return options; }
+		void SetOptions(Options opts) { options = std::move(opts); }
+
+		// func is called warmupRuns + runs times and must be repeatable
+		template <typename TFunc>
+		const Result& Run(std::string_view name, TFunc func) {
+			return Run(name, func, []() {});
+		}
+
+		// setup is called before every run, outside of the measured time,
+		// use it to reset the state that func changes
+		template <typename TFunc, typename TSetup>
+		const Result& Run(std::string_view name, TFunc func, TSetup setup) {
+			for (size_t i = 0; i < options.warmupRuns; ++i) {
+				setup();
+				RunOnce(func);
+			}
+
+			std::optional<PerfCounters> perf;
+			if (options.counters) {
+				perf.emplace();
+				if (!perf->Valid()) {
+					WarnNoCounters();
+					perf.reset();
+				}
+			}
+
+			Result result;
+			result.name = name;
+			std::vector<CounterValues> counters;
+			const auto runs = std::max<size_t>(options.runs, 1);
+			for (size_t i = 0; i < runs; ++i) {
+				setup();
+				if (perf)
+					perf->Start();
+				const auto start = std::chrono::steady_clock::now();
+				auto ret = RunOnce(func);
+				const auto end = std::chrono::steady_clock::now();
+				if (perf)
+					counters.push_back(perf->Stop());
+
+				result.timesMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+				if (i + 1 == runs)
+					result.ret = detail::ToText(ret);
+			}
+
+			Summarize(result, counters);
+			Print(std::cout, result);
+			results.push_back(std::move(result));
+			return results.back();
+		}
+
+		const std::vector<Result>& Results() const noexcept { return results; }
+
+		void WriteCsv(std::ostream& os) const {
+			os << "name,runs,min_ms,median_ms,p95_ms,mean_ms,stddev_ms";
+			for (const auto& counter : CounterNames)
+				os << ',' << counter;
+			os << ",ret\n";
+
+			for (const auto& r : results) {
+				os << detail::CsvQuoted(r.name) << ',' << r.timesMs.size() << ',' << r.minMs << ',' << r.medianMs
+					<< ',' << r.p95Ms << ',' << r.meanMs << ',' << r.stddevMs;
+				for (const auto& value : r.counters) {
+					os << ',';
+					if (r.hasCounters)
+						os << value;
+				}
+				os << ',' << detail::CsvQuoted(r.ret) << '\n';
+			}
+		}
+
+		void WriteJson(std::ostream& os) const {
+			os << "[\n";
+			for (size_t i = 0; i < results.size(); ++i) {
+				const auto& r = results[i];
+				os << "  { \"name\": " << detail::JsonQuoted(r.name) << ", \"runs\": " << r.timesMs.size()
+					<< ", \"min_ms\": " << r.minMs << ", \"median_ms\": " << r.medianMs << ", \"p95_ms\": " << r.p95Ms
+					<< ", \"mean_ms\": " << r.meanMs << ", \"stddev_ms\": " << r.stddevMs;
+				if (r.hasCounters) {
+					for (size_t c = 0; c < CounterNames.size(); ++c)
+						os << ", \"" << CounterNames[c] << "\": " << r.counters[c];
+				}
+				os << ", \"ret\": " << detail::JsonQuoted(r.ret) << " }" << (i + 1 < results.size() ? ",\n" : "\n");
+			}
+			os << "]\n";
+		}
+
+		// writes the files requested in the options, throws when a file can't be written
+		void WriteReports() const {
+			const auto write = [this](const std::string& path, void (Runner::*writer)(std::ostream&) const) {
+				if (path.empty())
+					return;
+				std::ofstream outFile{ path };
+				(this->*writer)(outFile);
+				if (!outFile)
+					throw std::runtime_error("Cannot write benchmark results to " + path);
+			};
+			write(options.csvPath, &Runner::WriteCsv);
+			write(options.jsonPath, &Runner::WriteJson);
+		}
+
+		static void Print(std::ostream& os, const Result& r) {
+			os << r.name << ": " << r.medianMs << " ms";
+			if (r.timesMs.size() > 1)
+				os << " (median of " << r.timesMs.size() << ", p95 " << r.p95Ms << ", stddev " << r.stddevMs << ")";
+			if (!r.ret.empty())
+				os << ", ret: " << r.ret;
+			os << '\n';
+
+			if (r.hasCounters) {
+				const auto get = [&r](Counter c) { return r.counters[static_cast<size_t>(c)]; };
+				const auto cycles = get(Counter::Cycles);
+				os << "    cycles: " << cycles << ", instructions: " << get(Counter::Instructions)
+					<< ", IPC: " << (cycles ? static_cast<double>(get(Counter::Instructions)) / static_cast<double>(cycles) : 0.0)
+					<< ", cache misses: " << get(Counter::CacheMisses) << ", branch misses: " << get(Counter::BranchMisses) << '\n';
+			}
+		}
+
+	private:
+		template <typename TFunc>
+		static auto RunOnce(TFunc& func) {
+			if constexpr (std::is_void_v<std::invoke_result_t<TFunc&>>) {
+				func();
+				return 0;
+			}
+			else {
+				auto ret = func();
+				DoNotOptimizeAway(ret);
+				return ret;
+			}
+		}
+
+		static void Summarize(Result& r, std::vector<CounterValues>& counters) {
+			auto sorted = r.timesMs;
+			std::ranges::sort(sorted);
+			const auto n = static_cast<double>(sorted.size());
+			r.minMs = sorted.front();
+			r.medianMs = sorted.size() % 2 ? sorted[sorted.size() / 2] : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2.0;
+			r.p95Ms = detail::Percentile(sorted, 0.95);
+			r.meanMs = std::accumulate(sorted.begin(), sorted.end(), 0.0) / n;
+			double sq = 0.0;
+			for (const auto t : sorted)
+				sq += (t - r.meanMs) * (t - r.meanMs);
+			r.stddevMs = sorted.size() > 1 ? std::sqrt(sq / (n - 1.0)) : 0.0;
+
+			if (!counters.empty()) {
+				r.hasCounters = true;
+				for (size_t c = 0; c < r.counters.size(); ++c) {
+					auto mid = counters.begin() + counters.size() / 2;
+					std::ranges::nth_element(counters, mid, {}, [c](const CounterValues& v) { return v[c]; });
+					r.counters[c] = (*mid)[c];
+				}
+			}
+		}
+
+		void WarnNoCounters() {
+			if (!warnedNoCounters)
+				std::cerr << "hardware counters are not available (see /proc/sys/kernel/perf_event_paranoid), timing only\n";
+			warnedNoCounters = true;
+		}
+
+	private:
+		Options options;
+		std::vector<Result> results;
+		bool warnedNoCounters{ false };
+	};
+
+	// used by RunAndMeasure() in simpleperf.h
+	inline Runner& DefaultRunner() {
+		static Runner runner;
+		return runner;
+	}
+
+	// Reads the --bench-* switches into the default runner and removes them from
+	// argv, so the program can parse its own positional arguments as before.
+	inline void Configure(int& argc, const char** argv) {
+		auto opts = DefaultRunner().GetOptions();
+		int kept = 1;
+		for (int i = 1; i < argc; ++i) {
+			const std::string_view arg{ argv[i] };
+			const auto value = [arg](std::string_view prefix) { return std::string{ arg.substr(prefix.size()) }; };
+
+			if (arg.starts_with("--bench-runs="))
+				opts.runs = std::strtoull(value("--bench-runs=").c_str(), nullptr, 10);
+			else if (arg.starts_with("--bench-warmup="))
+				opts.warmupRuns = std::strtoull(value("--bench-warmup=").c_str(), nullptr, 10);
+			else if (arg == "--bench-counters")
+				opts.counters = true;
+			else if (arg.starts_with("--bench-csv="))
+				opts.csvPath = value("--bench-csv=");
+			else if (arg.starts_with("--bench-json="))
+				opts.jsonPath = value("--bench-json=");
+			else
+				argv[kept++] = argv[i];
+		}
+		argc = kept;
+		argv[argc] = nullptr;
+		DefaultRunner().SetOptions(std::move(opts));
+	}
+}
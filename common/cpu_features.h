@@ -0,0 +1,64 @@
+#pragma once
+
+// Runtime detection of the x86 vector extensions, shared by the samples that pick
+// a SIMD kernel when they start (CSV scanner, SIMD filter). The kernels are compiled
+// with CPU_TARGET("isa") in files built without -mavx2/-mavx512f and only called
+// when the matching cpu::Has...() is true.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need the target attribute to emit AVX code in a file compiled without
+// the matching -m switch, MSVC accepts the intrinsics anywhere
+#if defined(CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CPU_TARGET(isa)
+#endif
+
+namespace cpu {
+
+	struct Features {
+		bool avx2{ false };
+		bool avx512f{ false };
+	};
+
+	namespace detail {
+		inline Features Detect() {
+			Features features;
+#ifdef CPU_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+			// the OS has to save the registers too: YMM state for AVX2, plus opmask and ZMM state for AVX-512
+			int info[4]{};
+			__cpuid(info, 0);
+			if (info[0] >= 7) {
+				__cpuid(info, 1);
+				const bool osxsave = info[2] & (1 << 27);
+				const auto xcr0 = osxsave ? _xgetbv(0) : 0;
+				__cpuidex(info, 7, 0);
+				features.avx2 = (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5));
+				features.avx512f = (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16));
+			}
+#else
+			features.avx2 = __builtin_cpu_supports("avx2");
+			features.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+#endif
+			return features;
+		}
+	}
+
+	// detected once, the first call runs cpuid
+	inline const Features& Get() {
+		static const Features features = detail::Detect();
+		return features;
+	}
+
+	inline bool HasAvx2() { return Get().avx2; }
+	inline bool HasAvx512f() { return Get().avx512f; }
+}
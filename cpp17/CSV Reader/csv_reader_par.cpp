@@ -4,42 +4,46 @@
 // 2018/2019
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <charconv>
 #include <chrono>
+#include <exception>
 #include <execution>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <mutex>
 #include <numeric>
 #include <optional>
 #include <string_view>
 #include <string>
 #include <utility>
+#include <variant>
 #include <vector>
+#include <version>
+#ifdef __cpp_lib_expected
+#include <expected>
+#endif
 
+#include "csv_scanner.h"
+#include "date_index.h"
+#include "group_by.h"
+#include "mapped_file.h"
+#include "order_table.h"
 #include "scope_timer.h"
 
 static const char* const CSV_EXTENSION = ".csv";
+static const char* const CACHE_EXTENSION = ".cache"; // appended to the name of the CSV file
 static constexpr char DEFAULT_DATE_DELIM = '-';
-static constexpr char CSV_DELIM = ';';
+static constexpr size_t DEFAULT_BLOCK_SIZE = 4 * 1024 * 1024;
 
 namespace fs = std::filesystem;
 
-[[nodiscard]] std::string GetFileContents(const fs::path& filePath) {
-    std::ifstream inFile{ filePath, std::ios::in | std::ios::binary };
-    if (!inFile)
-        throw std::runtime_error("Cannot open " + filePath.filename().string());
-
-    std::string str(static_cast<size_t>(fs::file_size(filePath)), 0);
-
-    inFile.read(str.data(), str.size());
-    if (!inFile)
-        throw std::runtime_error("Could not read the full contents from " + filePath.filename().string());
-
-    return str;
-}
-
 [[nodiscard]] std::vector<std::string_view> SplitString(std::string_view str, char delim) {
     std::vector<std::string_view> output;
 
@@ -81,13 +85,22 @@ template<typename T>
     return std::nullopt;
 }
 
-// as of Dec 2018 only MAVC supports floating point conversion
-// this code might be removed when GCC/Clang handles it as well
-#ifndef _MSC_VER
+// floating point from_chars came later than the integer one (GCC 11, Clang 17 with libc++),
+// older libraries parse from a copy on the stack, so there's still no allocation
+#ifndef __cpp_lib_to_chars
 template<>
 [[nodiscard]] std::optional<double> TryConvert(std::string_view sv) noexcept {
-    std::string str{ sv };
-    return ::atof(str.c_str());
+    char buf[64];
+    if (sv.empty() || sv.size() >= sizeof(buf))
+        return std::nullopt;
+    std::memcpy(buf, sv.data(), sv.size());
+    buf[sv.size()] = '\0';
+
+    char* end = nullptr;
+    const double value = std::strtod(buf, &end);
+    if (end != buf + sv.size())
+        return std::nullopt;
+    return value;
 }
 #endif
 
@@ -99,6 +112,9 @@ public:
     Date(uint8_t day, uint8_t month, uint16_t year) : mDay(day), mMonth(month), mYear(year) { }
     explicit Date(std::string_view sv, char delim = DEFAULT_DATE_DELIM, Format fmt = Format::DayMonthYear);
 
+    // doesn't throw or allocate, returns nullopt for a wrong format or an invalid date
+    [[nodiscard]] static std::optional<Date> TryParse(std::string_view sv, char delim = DEFAULT_DATE_DELIM, Format fmt = Format::DayMonthYear) noexcept;
+
     bool IsInvalid() const {
         return mDay == 0 || mMonth == 0 || mYear == 0 || mDay > 31 || mMonth > 12;
     }
@@ -111,8 +127,11 @@ public:
         return std::tie(lhs.mYear, lhs.mMonth, lhs.mDay) <= std::tie(rhs.mYear, rhs.mMonth, rhs.mDay);
     }
 
+    // yyyy|mm|dd in the bits of an int, so the keys compare like the dates
+    int32_t Packed() const noexcept { return (mYear << 9) | (mMonth << 5) | mDay; }
+
     friend std::ostream& operator<<(std::ostream &os, const Date &d) {
-        return os << d.mDay << DEFAULT_DATE_DELIM << d.mMonth << DEFAULT_DATE_DELIM << d.mYear;
+        return os << +d.mDay << DEFAULT_DATE_DELIM << +d.mMonth << DEFAULT_DATE_DELIM << d.mYear;
     }
 
 private:
@@ -122,33 +141,65 @@ private:
 };
 
 Date::Date(std::string_view sv, char delim, Date::Format fmt) {
-    const auto columns = SplitString(sv, delim);
-    if (columns.size() == 3) {
-        mDay = TryConvert<uint8_t>(columns[fmt == Format::DayMonthYear ? 0 : 2]).value_or(0);
-        mMonth = TryConvert<uint8_t>(columns[1]).value_or(0);
-        mYear = TryConvert<uint16_t>(columns[fmt == Format::DayMonthYear ? 2 : 0]).value_or(0);
+    const auto date = TryParse(sv, delim, fmt);
+    if (!date)
+        throw std::runtime_error("Cannot convert date from " + std::string(sv));
+    *this = *date;
+}
 
-        if (IsInvalid())
-            throw std::runtime_error("Cannot convert date from " + std::string(sv));
-    }
-    else
-        throw std::runtime_error("Cannot convert date, wrong element count/format, " + std::string(sv));
+// Day and month have one or two digits, the year up to four, so the parts are
+// read digit by digit without splitting the string first.
+std::optional<Date> Date::TryParse(std::string_view sv, char delim, Date::Format fmt) noexcept {
+    size_t pos = 0;
+    const auto readPart = [sv, delim, &pos](size_t maxDigits, bool last) -> unsigned {
+        unsigned value = 0;
+        const size_t start = pos;
+        while (pos < sv.size() && pos - start < maxDigits && sv[pos] >= '0' && sv[pos] <= '9')
+            value = value * 10 + static_cast<unsigned>(sv[pos++] - '0');
+        if (pos == start)
+            return 0; // 0 makes the date invalid
+        return last || (pos < sv.size() && sv[pos++] == delim) ? value : 0;
+    };
+
+    const bool dayFirst = fmt == Format::DayMonthYear;
+    const unsigned first = readPart(dayFirst ? 2 : 4, false);
+    const unsigned month = readPart(2, false);
+    const unsigned last = readPart(dayFirst ? 4 : 2, true);
+    if (pos != sv.size())
+        return std::nullopt;
+
+    const Date date(static_cast<uint8_t>(dayFirst ? first : last), static_cast<uint8_t>(month), static_cast<uint16_t>(dayFirst ? last : first));
+    if (date.IsInvalid())
+        return std::nullopt;
+    return date;
 }
 
+// A parsed line. The coupon code is a view into the CSV text, so the text has to outlive
+// the record. That keeps a record trivially copyable and parsing it free of allocations.
 class OrderRecord {
 public:
     OrderRecord() = default;
-    OrderRecord(Date date, std::string coupon, double unitPrice, double discount, unsigned int quantity)
+    OrderRecord(Date date, std::string_view coupon, double unitPrice, double discount, unsigned int quantity)
         : mDate(date)
-        , mCouponCode(std::move(coupon))
+        , mCouponCode(coupon)
         , mUnitPrice(unitPrice)
         , mDiscount(discount)
         , mQuantity(quantity)
     { }
 
-    double CalcRecordPrice() const { return mQuantity * (mUnitPrice*(1.0 - mDiscount)); }
-    bool CheckDate(const Date& startDate, const Date& endDate) const {
-        return (startDate.IsInvalid() || startDate <= mDate) && (endDate.IsInvalid() || mDate <= endDate);
+    // a coupon code with quotes written twice is unescaped into scratch first
+    void AppendTo(OrderTable& table, char quote, std::string& scratch) const {
+        auto coupon = mCouponCode;
+        if (coupon.find(quote) != std::string_view::npos) {
+            scratch.clear();
+            for (size_t i = 0; i < coupon.size(); ++i) {
+                scratch += coupon[i];
+                if (coupon[i] == quote && i + 1 < coupon.size() && coupon[i + 1] == quote)
+                    ++i;
+            }
+            coupon = scratch;
+        }
+        table.Append(mDate.Packed(), coupon, mUnitPrice, mDiscount, mQuantity);
     }
 
 public:
@@ -157,67 +208,394 @@ public:
 
 private:
     Date mDate;
-    std::string mCouponCode;
+    std::string_view mCouponCode;
     double mUnitPrice{ 0.0 };
     double mDiscount{ 0.0 }; // 0... 1.0
     unsigned int mQuantity{ 0 };
 };
 
-[[nodiscard]] OrderRecord LineToRecord(std::string_view sv){
-    const auto columns = SplitString(sv, CSV_DELIM);
-    if (columns.size() == static_cast<size_t>(OrderRecord::ENUM_LENGTH)) { // assuming we also might encounter empty "columns"
-        const auto unitPrice = TryConvert<double>(columns[OrderRecord::UNIT_PRICE]);
-        const auto discount = TryConvert<double>(columns[OrderRecord::DISCOUNT]);
-        const auto quantity = TryConvert<unsigned int>(columns[OrderRecord::QUANTITY]);
-
-        if (unitPrice && discount && quantity) {
-            return { Date(columns[OrderRecord::DATE]),
-                     std::string(columns[OrderRecord::COUPON]),
-                     *unitPrice,
-                     *discount,
-                     *quantity };
+// where the columns of OrderRecord are in a line, a header might name them in another order
+struct ColumnMap {
+    static constexpr size_t MaxFields = 32;
+
+    std::array<size_t, OrderRecord::ENUM_LENGTH> mField{ OrderRecord::DATE, OrderRecord::COUPON, OrderRecord::UNIT_PRICE, OrderRecord::DISCOUNT, OrderRecord::QUANTITY };
+    size_t mNumFields{ OrderRecord::ENUM_LENGTH };
+};
+
+// the columns are found by name, in any case and order, other columns are skipped
+[[nodiscard]] ColumnMap ReadHeader(const FieldIndex& index, char quote) {
+    static constexpr std::array<std::array<std::string_view, 3>, OrderRecord::ENUM_LENGTH> Names{ {
+        { "date" }, { "coupon", "coupon_code", "couponcode" }, { "unit_price", "unitprice", "price" }, { "discount" }, { "quantity", "qty" }
+    } };
+
+    std::array<std::string_view, ColumnMap::MaxFields> fields;
+    ColumnMap columns;
+    columns.mNumFields = index.GetFields(0, fields);
+    if (columns.mNumFields > ColumnMap::MaxFields)
+        throw std::runtime_error("Too many columns in the header " + std::string(index.Line(0)));
+
+    for (size_t col = 0; col < OrderRecord::ENUM_LENGTH; ++col) {
+        const auto it = std::find_if(fields.begin(), fields.begin() + columns.mNumFields, [&names = Names[col], quote](std::string_view field) {
+            field = StripQuotes(field, quote);
+            return std::any_of(names.begin(), names.end(), [field](std::string_view name) {
+                return !name.empty() && std::equal(field.begin(), field.end(), name.begin(), name.end(),
+                    [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+            });
+        });
+        if (it == fields.begin() + columns.mNumFields)
+            throw std::runtime_error("No " + std::string(Names[col][0]) + " column in the header " + std::string(index.Line(0)));
+        columns.mField[col] = static_cast<size_t>(it - fields.begin());
+    }
+    return columns;
+}
+
+#ifdef __cpp_lib_expected
+template <typename T, typename E>
+using Expected = std::expected<T, E>;
+
+template <typename E>
+[[nodiscard]] std::unexpected<E> MakeUnexpected(E error) { return std::unexpected<E>(error); }
+#else
+// the part of std::expected (C++23) that is used here
+template <typename E>
+struct Unexpected {
+    E mError;
+};
+
+template <typename E>
+[[nodiscard]] Unexpected<E> MakeUnexpected(E error) { return { error }; }
+
+template <typename T, typename E>
+class Expected {
+public:
+    Expected(const T& value) : mValue(std::in_place_index<0>, value) { }
+    Expected(Unexpected<E> error) : mValue(std::in_place_index<1>, error.mError) { }
+
+    bool has_value() const noexcept { return mValue.index() == 0; }
+    explicit operator bool() const noexcept { return has_value(); }
+    const T& operator*() const noexcept { return *std::get_if<0>(&mValue); }
+    const E& error() const noexcept { return *std::get_if<1>(&mValue); }
+
+private:
+    std::variant<T, E> mValue;
+};
+#endif
+
+// why a line cannot be converted, the first wrong field wins
+enum class LineError : uint8_t { None, FieldCount, Date, UnitPrice, Discount, Quantity };
+
+const char* ToString(LineError error) {
+    switch (error) {
+    case LineError::None: return "no error";
+    case LineError::FieldCount: return "wrong number of fields";
+    case LineError::Date: return "wrong date";
+    case LineError::UnitPrice: return "wrong unit price";
+    case LineError::Discount: return "wrong discount";
+    default: return "wrong quantity";
+    }
+}
+
+// doesn't throw or allocate, also for wrong lines
+[[nodiscard]] Expected<OrderRecord, LineError> TryLineToRecord(const FieldIndex& index, size_t line, const ColumnMap& columns, char quote) noexcept {
+    std::array<std::string_view, ColumnMap::MaxFields> fields;
+    if (index.GetFields(line, fields) != columns.mNumFields) // assuming we also might encounter empty "columns"
+        return MakeUnexpected(LineError::FieldCount);
+
+    const auto column = [&](OrderRecord::Indices col) { return StripQuotes(fields[columns.mField[col]], quote); };
+    const auto date = Date::TryParse(column(OrderRecord::DATE));
+    if (!date)
+        return MakeUnexpected(LineError::Date);
+    const auto unitPrice = TryConvert<double>(column(OrderRecord::UNIT_PRICE));
+    if (!unitPrice)
+        return MakeUnexpected(LineError::UnitPrice);
+    const auto discount = TryConvert<double>(column(OrderRecord::DISCOUNT));
+    if (!discount)
+        return MakeUnexpected(LineError::Discount);
+    const auto quantity = TryConvert<unsigned int>(column(OrderRecord::QUANTITY));
+    if (!quantity)
+        return MakeUnexpected(LineError::Quantity);
+
+    return OrderRecord{ *date, column(OrderRecord::COUPON), *unitPrice, *discount, *quantity };
+}
+
+// Converts the lines of the index from firstLine on, outRecords gets one record per line and
+// outErrors the error of every line, LineError::None for the converted ones. Nothing throws
+// inside of the parallel loop, the caller decides what a wrong line means.
+void IndexToRecords(const FieldIndex& index, size_t firstLine, const ColumnMap& columns, char quote, std::vector<OrderRecord>& outRecords, std::vector<LineError>& outErrors) {
+    ScopeTimer _t("IndexToRecords"_timer, /*store*/true);
+
+    const size_t count = index.NumLines() - std::min(firstLine, index.NumLines());
+    outRecords.resize(count);
+    outErrors.resize(count);
+
+    // the line number comes from the position of the output record, so no index vector is needed
+    const auto pFirst = outRecords.data();
+    std::for_each(std::execution::par, outRecords.begin(), outRecords.end(), [&, pFirst](OrderRecord& rec) {
+        const auto i = static_cast<size_t>(&rec - pFirst);
+        const auto result = TryLineToRecord(index, firstLine + i, columns, quote);
+        if (result)
+            rec = *result;
+        outErrors[i] = result ? LineError::None : result.error();
+    });
+}
+
+// Wrong lines of a file: all of them are counted, only the first few are kept with their
+// line number and text, so a file full of garbage doesn't fill the memory with copies of it.
+class ParseErrorLog {
+public:
+    static constexpr size_t MaxSamples = 10;
+
+    struct Sample {
+        uint64_t mLine{ 0 }; // 1 based, the header is line 1
+        LineError mError{ LineError::None };
+        std::string mText;
+    };
+
+    void Add(uint64_t line, LineError error, std::string_view text) {
+        ++mCount;
+        if (mSamples.size() < MaxSamples)
+            mSamples.push_back({ line, error, std::string(text) });
+    }
+
+    uint64_t Count() const noexcept { return mCount; }
+    const std::vector<Sample>& Samples() const noexcept { return mSamples; }
+
+private:
+    uint64_t mCount{ 0 };
+    std::vector<Sample> mSamples;
+};
+
+// Turns CSV text into table rows, block by block. The index, the records and the column
+// map are kept between the blocks of a file; the header is read from the first block.
+// Without an error log the first wrong line throws, with one wrong lines are logged and skipped.
+class OrderParser {
+public:
+    explicit OrderParser(const CsvDialect& dialect, ParseErrorLog* errors = nullptr) : mDialect(dialect), mErrorLog(errors) { }
+
+    // Appends the complete records at the front of data to the table and returns their
+    // size in bytes, 0 if not even one record is complete. With final the data ends with the file.
+    size_t Parse(std::string_view data, bool final, OrderTable& outTable) {
+        {
+            ScopeTimer _tIndex("Index Block"_timer, /*store*/true);
+            mIndex.Build(data, mDialect, final);
+        }
+
+        size_t firstLine = 0;
+        if (mDialect.mHeader && !mHeaderRead && mIndex.NumLines() > 0) {
+            mColumns = ReadHeader(mIndex, mDialect.mQuote);
+            mHeaderRead = true;
+            firstLine = 1;
+        }
+        IndexToRecords(mIndex, firstLine, mColumns, mDialect.mQuote, mRecords, mErrors);
+
+        ScopeTimer _t("RecordsToTable"_timer, /*store*/true);
+        for (size_t i = 0; i < mRecords.size(); ++i) {
+            if (mErrors[i] == LineError::None) {
+                mRecords[i].AppendTo(outTable, mDialect.mQuote, mCoupon);
+                continue;
+            }
+
+            // a new line inside of quotes doesn't start a line here, the number counts records
+            const auto lineNumber = mLinesBefore + firstLine + i + 1;
+            const auto text = mIndex.Line(firstLine + i);
+            if (!mErrorLog)
+                throw std::runtime_error("Cannot convert Record from " + std::string(text) + " (line " + std::to_string(lineNumber) + ": " + ToString(mErrors[i]) + ")");
+            mErrorLog->Add(lineNumber, mErrors[i], text);
         }
+        mLinesBefore += mIndex.NumLines();
+
+        return mIndex.Consumed();
+    }
+
+private:
+    const CsvDialect mDialect;
+    ParseErrorLog* const mErrorLog;
+    FieldIndex mIndex;
+    std::vector<OrderRecord> mRecords;
+    std::vector<LineError> mErrors; // of mRecords
+    ColumnMap mColumns;
+    bool mHeaderRead{ false };
+    uint64_t mLinesBefore{ 0 }; // in the blocks parsed before
+    std::string mCoupon; // for coupon codes with quotes written twice
+};
+
+// with an error log wrong lines are skipped, see OrderParser
+[[nodiscard]] OrderTable LoadRecords(const fs::path& filename, const CsvDialect& dialect, ParseErrorLog* errors = nullptr) {
+    //ScopeTimer _t("LoadRecords"_timer);
+
+    // the lines point into the mapping, the file is never copied
+    MappedFile file;
+    {
+        ScopeTimer _t("Reading File"_timer, /*store*/true);
+        file = MappedFile{ filename };
+        file.Prefault();
+    }
+
+    ScopeTimer _t("Parsing Strings"_timer, /*store*/true);
+
+    // parsed block by block, so the index and the row records stay small and are reused
+    OrderTable table;
+    OrderParser parser{ dialect, errors };
+    for (auto rest = file.View(); !rest.empty(); ) {
+        size_t consumed = 0;
+        for (size_t blockSize = DEFAULT_BLOCK_SIZE; consumed == 0; blockSize *= 2) // a record longer than a block
+            consumed = parser.Parse(rest.substr(0, blockSize), /*final*/rest.size() <= blockSize, table);
+        rest.remove_prefix(consumed);
+    }
+
+    return table;
+}
+
+[[nodiscard]] fs::path CachePath(const fs::path& csvPath) {
+    auto cachePath = csvPath;
+    cachePath += CACHE_EXTENSION;
+    return cachePath;
+}
+
+// a cache made from a file of another size or modification time, or read with another dialect, is stale,
+// and so is one that skipped wrong lines for a run that has to report them
+[[nodiscard]] OrderTable::ImageKey CacheKey(const fs::path& csvPath, const CsvDialect& dialect, bool skipBadLines) {
+    return { fs::file_size(csvPath),
+             static_cast<int64_t>(fs::last_write_time(csvPath).time_since_epoch().count()),
+             csvPath.filename().string(),
+             static_cast<uint32_t>(static_cast<unsigned char>(dialect.mDelim)) | static_cast<uint32_t>(static_cast<unsigned char>(dialect.mQuote)) << 8 |
+                 (dialect.mHeader ? 1u << 16 : 0u) | (skipBadLines ? 1u << 17 : 0u) };
+}
+
+// Maps the cached columns of the file, the text is parsed only when there's no valid cache,
+// and then the cache is written for the next run. The wrong lines of the file are logged
+// only by the run that parses it.
+[[nodiscard]] OrderTable LoadCachedRecords(const fs::path& filename, const CsvDialect& dialect, ParseErrorLog* errors = nullptr) {
+    const auto key = CacheKey(filename, dialect, errors != nullptr);
+    const auto cachePath = CachePath(filename);
+    try {
+        ScopeTimer _t("Reading Cache"_timer, /*store*/true);
+        if (auto table = OrderTable::LoadImage(cachePath, key))
+            return std::move(*table);
+    }
+    catch (const std::runtime_error&) {
+        // an unreadable cache is the same as no cache
+    }
+
+    auto table = LoadRecords(filename, dialect, errors);
+    try {
+        ScopeTimer _t("Writing Cache"_timer, /*store*/true);
+        table.SaveImage(cachePath, key);
     }
-    throw std::runtime_error("Cannot convert Record from " + std::string(sv));
+    catch (const std::runtime_error& err) {
+        // for example a read only directory, the results are still fine
+        std::cerr << "cannot write the cache: " << err.what() << '\n';
+    }
+    return table;
 }
 
-[[nodiscard]] std::vector<OrderRecord> LinesToRecords(const std::vector<std::string_view>& lines) {
-    //ScopeTimer _t(__func__, /*store*/true);
+// an invalid date means no limit
+[[nodiscard]] DayRange ToDayRange(const Date& startDate, const Date& endDate) noexcept {
+    return { startDate.IsInvalid() ? std::numeric_limits<int32_t>::min() : startDate.Packed(),
+             endDate.IsInvalid() ? std::numeric_limits<int32_t>::max() : endDate.Packed() };
+}
 
-    std::vector<OrderRecord> outRecords(lines.size());
-    std::transform(std::execution::par, std::begin(lines), std::end(lines), std::begin(outRecords), LineToRecord);
-    
-    // not going to work, as we need forward iterators for parallel execution...
-    // std::transform(std::execution::par, lines.begin(), lines.end(), std::back_inserter(outRecords), LineToRecord);
+double CalcTotalOrder(const OrderTable& table, const Date& startDate, const Date& endDate) {
+    ScopeTimer _t("CalcTotalOrder"_timer, /*store*/true);
 
-    return outRecords;
+    const auto range = ToDayRange(startDate, endDate);
+    return table.SumOrders(range.mFirstDay, range.mLastDay);
 }
 
-[[nodiscard]] std::vector<OrderRecord> LoadRecords(const fs::path& filename) {
-    //ScopeTimer _t(__func__);
-    const auto content = GetFileContents(filename);
+// Streaming mode: reads the file in fixed size blocks and passes the table of every
+// block to onBlock right away, so the memory use depends on the block size, not on the file size.
+// A record cut at the end of a block is moved to the front of the buffer and completed
+// by the next read; the buffer only grows when a single record is longer than a block.
+template <typename Func>
+void StreamTables(const fs::path& filename, const CsvDialect& dialect, size_t blockSize, ParseErrorLog* errors, Func onBlock) {
+    std::ifstream inFile{ filename, std::ios::in | std::ios::binary };
+    if (!inFile)
+        throw std::runtime_error("Cannot open " + filename.filename().string());
 
-    ScopeTimer _t("Parsing Strings", /*store*/true);
-    const auto lines = SplitLines(content);
+    std::string buffer;
+    size_t carried = 0; // bytes of an unfinished record at the front of buffer
+
+    OrderParser parser{ dialect, errors };
+    OrderTable table;
+
+    while (inFile) {
+        buffer.resize(carried + blockSize);
+        size_t valid = carried;
+        {
+            ScopeTimer _t("Reading File"_timer, /*store*/true);
+            inFile.read(buffer.data() + carried, static_cast<std::streamsize>(blockSize));
+            valid += static_cast<size_t>(inFile.gcount());
+        }
+        if (inFile.bad())
+            throw std::runtime_error("Could not read the contents from " + filename.filename().string());
 
-    return LinesToRecords(lines);
+        // at the end of the file the last record doesn't need a new line char
+        const std::string_view data{ buffer.data(), valid };
+        size_t complete = 0;
+        {
+            ScopeTimer _t("Parsing Strings"_timer, /*store*/true);
+            table.Clear();
+            complete = parser.Parse(data, /*final*/inFile.eof(), table);
+        }
+        if (table.Size() > 0)
+            onBlock(static_cast<const OrderTable&>(table));
+
+        carried = valid - complete;
+        std::memmove(buffer.data(), buffer.data() + complete, carried);
+    }
 }
 
-double CalcTotalOrder(const std::vector<OrderRecord>& records, const Date& startDate, const Date& endDate) {
-    ScopeTimer _t(__func__, /*store*/true);
-
-    return std::transform_reduce(
-        std::execution::par,
-        std::begin(records), std::end(records),
-        0.0,
-        std::plus<>(),
-        [&startDate, &endDate](const OrderRecord& rec) {
-            if (rec.CheckDate(startDate, endDate))
-                return rec.CalcRecordPrice();
-            else
-                return 0.0;
+[[nodiscard]] double StreamTotalOrder(const fs::path& filename, const CsvDialect& dialect, const Date& startDate, const Date& endDate, size_t blockSize, ParseErrorLog* errors) {
+    double total = 0.0;
+    StreamTables(filename, dialect, blockSize, errors, [&](const OrderTable& table) { total += CalcTotalOrder(table, startDate, endDate); });
+    return total;
+}
+
+// compares the line and field splitting of SplitLines/SplitString with the SIMD field index
+void BenchmarkScanners(const std::vector<fs::path>& paths, const CsvDialect& dialect) {
+    constexpr int Runs = 5;
+
+    // best of several runs, in GB/s
+    const auto measure = [](size_t bytes, auto func) {
+        double bestMs = std::numeric_limits<double>::max();
+        for (int i = 0; i < Runs; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            const auto end = std::chrono::steady_clock::now();
+            bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(end - start).count());
         }
-    );
+        return static_cast<double>(bytes) / (bestMs * 1e6);
+    };
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& p : paths) {
+        const MappedFile file{ p };
+        file.Prefault();
+        const auto data = file.View();
+
+        size_t fields = 0;
+        const auto splitSpeed = measure(data.size(), [data, &dialect, &fields]() {
+            fields = 0;
+            for (const auto& line : SplitLines(data))
+                fields += SplitString(line, dialect.mDelim).size();
+        });
+        std::cout << p.string() << ", " << data.size() << " bytes, " << fields << " fields\n";
+        std::cout << "    SplitLines + SplitString: " << splitSpeed << " GB/s\n";
+
+        FieldIndex index;
+        for (const auto kernel : { ScanKernel::Scalar, ScanKernel::Sse2, ScanKernel::Avx2 }) {
+            if (kernel > BestScanKernel())
+                continue;
+
+            const auto indexSpeed = measure(data.size(), [data, &dialect, &index, kernel]() {
+                for (auto rest = data; !rest.empty(); ) {
+                    index.Build(rest.substr(0, DEFAULT_BLOCK_SIZE), dialect, /*final*/rest.size() <= DEFAULT_BLOCK_SIZE, kernel);
+                    rest.remove_prefix(index.Consumed());
+                }
+            });
+            std::cout << "    FieldIndex " << ToString(kernel) << ": " << indexSpeed << " GB/s\n";
+        }
+    }
 }
 
 bool IsCSVFile(const fs::path &p) {
@@ -234,32 +612,152 @@ bool IsCSVFile(const fs::path &p) {
 struct Result {
     std::string mFilename;
     double mSum{ 0.0 };
+    double mMs{ 0.0 }; // elapsed time of loading and summing the file
 };
 
-[[nodiscard]] std::vector<Result> CalcResults(const std::vector<fs::path>& paths, Date startDate, Date endDate) {
-    ScopeTimer _t(__func__, /*store*/true);
+// the wrong lines of all files of a run, the files are parsed in parallel
+class BadLineReport {
+public:
+    void Add(std::string filename, ParseErrorLog errors) {
+        if (errors.Count() == 0)
+            return;
+        std::lock_guard lock(mMutex);
+        mFiles.emplace_back(std::move(filename), std::move(errors));
+    }
 
-    // we want to show the sum of all LoadRecords() and CalcTotalOrder() calls, but it's important to execute those functions
-    // on a single thread. Make sure CalcResults() calls this function with sequential execution
-    // otherwise the timings might shows wrong results (the timer is not thread safe, and also we'd show the sum of all calls, 
-    // not the total time they all used...)
+    void Show() {
+        std::lock_guard lock(mMutex);
+        std::sort(mFiles.begin(), mFiles.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (const auto& [filename, errors] : mFiles) {
+            std::cerr << filename << ": skipped " << errors.Count() << (errors.Count() == 1 ? " wrong line\n" : " wrong lines\n");
+            for (const auto& [line, error, text] : errors.Samples())
+                std::cerr << "    line " << line << ", " << ToString(error) << ": " << text << '\n';
+            if (errors.Count() > errors.Samples().size())
+                std::cerr << "    ...\n";
+        }
+    }
 
-    std::vector<Result> results(paths.size());
-    std::transform(std::execution::seq, paths.begin(), paths.end(), results.begin(), [startDate, endDate](const fs::path& p) {
-        const auto records = LoadRecords(p);
+private:
+    std::mutex mMutex;
+    std::vector<std::pair<std::string, ParseErrorLog>> mFiles;
+};
 
-        const auto totalValue = CalcTotalOrder(records, startDate, endDate);
-        return Result{ p.string(), totalValue };
+enum class InputMode { Buffered, Streaming };
+
+struct InputOptions {
+    InputMode mMode{ InputMode::Buffered };
+    size_t mBlockSize{ DEFAULT_BLOCK_SIZE }; // used in the streaming mode
+    bool mUseCache{ false }; // used in the buffered mode
+    CsvDialect mDialect;
+    BadLineReport* mBadLines{ nullptr }; // wrong lines are skipped and reported here, without it the first one throws
+};
+
+// Calls func(path, errors) for every file and returns the results in the order of paths, with
+// the elapsed time of each file in mMs. errors is the log of the file's wrong lines, nullptr when
+// the input has no report, and the logs go to the report once all files are done.
+//
+// Files run in parallel and the parsing and summing inside of a file run in parallel as well,
+// all of them are tasks of the same work stealing pool, so threads that finish small files
+// help with the chunks of the big ones. The largest files start first, so a big file
+// doesn't start last and leave the other threads idle.
+// The stored ScopeTimer results are then sums over all threads, the elapsed time
+// of a single file is kept in its result.
+template <typename R, typename Func>
+[[nodiscard]] std::vector<R> ProcessFiles(const std::vector<fs::path>& paths, const InputOptions& input, Func func) {
+    std::vector<size_t> order(paths.size());
+    std::iota(order.begin(), order.end(), size_t{ 0 });
+    std::vector<uintmax_t> sizes(paths.size());
+    std::transform(paths.begin(), paths.end(), sizes.begin(), [](const fs::path& p) { return fs::file_size(p); });
+    std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    // an exception must not leave a parallel algorithm (that calls std::terminate), so it's rethrown afterwards
+    std::vector<R> results(paths.size());
+    std::vector<std::exception_ptr> errors(paths.size());
+    std::vector<ParseErrorLog> badLines(input.mBadLines ? paths.size() : 0);
+    std::for_each(std::execution::par, order.begin(), order.end(), [&](size_t i) {
+        try {
+            const auto start = std::chrono::steady_clock::now();
+            results[i] = func(paths[i], input.mBadLines ? &badLines[i] : nullptr);
+            results[i].mMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        catch (...) {
+            errors[i] = std::current_exception();
+        }
     });
+
+    for (const auto& err : errors) {
+        if (err)
+            std::rethrow_exception(err);
+    }
+    for (size_t i = 0; i < badLines.size(); ++i)
+        input.mBadLines->Add(paths[i].string(), std::move(badLines[i]));
     return results;
 }
 
+[[nodiscard]] OrderTable LoadTable(const fs::path& p, const InputOptions& input, ParseErrorLog* errors) {
+    return input.mUseCache ? LoadCachedRecords(p, input.mDialect, errors) : LoadRecords(p, input.mDialect, errors);
+}
+
+[[nodiscard]] std::vector<Result> CalcResults(const std::vector<fs::path>& paths, Date startDate, Date endDate, const InputOptions& input) {
+    ScopeTimer _t("CalcResults"_timer, /*store*/true);
+
+    return ProcessFiles<Result>(paths, input, [startDate, endDate, &input](const fs::path& p, ParseErrorLog* errors) {
+        if (input.mMode == InputMode::Streaming)
+            return Result{ p.string(), StreamTotalOrder(p, input.mDialect, startDate, endDate, input.mBlockSize, errors) };
+
+        const auto table = LoadTable(p, input, errors);
+
+        const auto totalValue = CalcTotalOrder(table, startDate, endDate);
+        return Result{ p.string(), totalValue };
+    });
+}
+
+struct QueryRange {
+    std::string mLabel;
+    DayRange mDays;
+};
+
+struct RangeResult {
+    std::string mFilename;
+    std::vector<double> mSums; // one per QueryRange
+    double mMs{ 0.0 };
+};
+
+// Query mode: every file is summed once into a date index, which then answers all ranges
+[[nodiscard]] std::vector<RangeResult> CalcRangeResults(const std::vector<fs::path>& paths, const std::vector<QueryRange>& ranges, const InputOptions& input) {
+    ScopeTimer _t("CalcRangeResults"_timer, /*store*/true);
+
+    std::vector<DayRange> dayRanges(ranges.size());
+    std::transform(ranges.begin(), ranges.end(), dayRanges.begin(), [](const QueryRange& r) { return r.mDays; });
+
+    return ProcessFiles<RangeResult>(paths, input, [&dayRanges, &input](const fs::path& p, ParseErrorLog* errors) {
+        DateIndex index;
+        if (input.mMode == InputMode::Streaming) {
+            StreamTables(p, input.mDialect, input.mBlockSize, errors, [&index](const OrderTable& table) {
+                ScopeTimer _tIndex("Building Date Index"_timer, /*store*/true);
+                index.Add(table);
+            });
+        }
+        else {
+            const auto table = LoadTable(p, input, errors);
+
+            ScopeTimer _tIndex("Building Date Index"_timer, /*store*/true);
+            index.Add(table);
+        }
+
+        ScopeTimer _tQuery("Range Queries"_timer, /*store*/true);
+        RangeResult result{ p.string(), std::vector<double>(dayRanges.size()) };
+        index.Sums(dayRanges, result.mSums);
+        return result;
+    });
+}
+
 void ShowResults(const std::vector<Result>& results, Date startDate, Date endDate) {
     const size_t maxStringLen = std::accumulate(std::cbegin(results), std::cend(results), 0,
         [](size_t l, const auto &result) { return std::max(l, result.mFilename.length()); }
     );
 
-    std::cout << std::setw(maxStringLen + 1) << std::left << "Name Of File";
+    std::cout << std::setw(maxStringLen + 1) << std::left << "Name Of File" << " | " << std::setw(10) << "Time (ms)";
     if (!startDate.IsInvalid() && !endDate.IsInvalid())
         std::cout << " | Total Orders Value between " << startDate << " and " << endDate << '\n';
     else if (!startDate.IsInvalid())
@@ -267,32 +765,277 @@ void ShowResults(const std::vector<Result>& results, Date startDate, Date endDat
     else
         std::cout << " | Total Orders Value\n";
 
-    for (const auto&[fileName, sum] : results)
-        std::cout << std::setw(maxStringLen + 1) << std::left << fileName << " | " << std::fixed << std::setprecision(2) << sum << '\n';
+    for (const auto&[fileName, sum, ms] : results) {
+        std::cout << std::setw(maxStringLen + 1) << std::left << fileName << " | " << std::fixed << std::setprecision(2)
+                  << std::setw(10) << ms << " | " << sum << '\n';
+    }
+
+    ScopeTimer::ShowStoredResults();
+}
+
+// one row of the grouped report
+struct GroupResult {
+    std::string mCoupon;
+    uint32_t mYear{ 0 };
+    uint32_t mMonth{ 0 };
+    uint64_t mOrders{ 0 };
+    double mSum{ 0.0 };
+};
+
+// groups of a file, the coupon codes of the keys are the codes of the file's table
+struct FileGroups {
+    std::string mFilename;
+    GroupTable mGroups;
+    std::vector<std::string> mCoupons; // names by code
+    double mMs{ 0.0 };
+};
+
+// Group-by mode: the orders of all files in the date range, grouped by coupon code and month
+[[nodiscard]] std::vector<GroupResult> CalcGroupResults(const std::vector<fs::path>& paths, Date startDate, Date endDate, const InputOptions& input) {
+    ScopeTimer _t("CalcGroupResults"_timer, /*store*/true);
+
+    const auto range = ToDayRange(startDate, endDate);
+    const auto copyNewCoupons = [](const OrderTable& table, std::vector<std::string>& names) {
+        for (auto code = static_cast<uint32_t>(names.size()); code < table.NumCoupons(); ++code)
+            names.emplace_back(table.CouponName(code));
+    };
+
+    const auto perFile = ProcessFiles<FileGroups>(paths, input, [range, &input, &copyNewCoupons](const fs::path& p, ParseErrorLog* errors) {
+        FileGroups result;
+        result.mFilename = p.string();
+        if (input.mMode == InputMode::Streaming) {
+            // the table of the stream keeps its coupon dictionary, so the codes are the same in every block
+            StreamTables(p, input.mDialect, input.mBlockSize, errors, [&](const OrderTable& table) {
+                ScopeTimer _tGroup("Grouping"_timer, /*store*/true);
+                result.mGroups.Merge(GroupByCouponMonth(table, range));
+                copyNewCoupons(table, result.mCoupons);
+            });
+        }
+        else {
+            const auto table = LoadTable(p, input, errors);
+
+            ScopeTimer _tGroup("Grouping"_timer, /*store*/true);
+            result.mGroups = GroupByCouponMonth(table, range);
+            copyNewCoupons(table, result.mCoupons);
+        }
+        return result;
+    });
+
+    // the codes of the files are mapped to codes of all files by name
+    ScopeTimer _tMerge("Merging Groups"_timer, /*store*/true);
+    std::vector<std::string> coupons;
+    std::unordered_map<std::string_view, uint32_t> couponCodes;
+    GroupTable groups;
+    for (const auto& file : perFile) {
+        std::vector<uint32_t> toGlobal(file.mCoupons.size());
+        for (size_t i = 0; i < file.mCoupons.size(); ++i) {
+            const auto [it, added] = couponCodes.try_emplace(file.mCoupons[i], static_cast<uint32_t>(couponCodes.size()));
+            toGlobal[i] = it->second;
+        }
+        file.mGroups.ForEach([&groups, &toGlobal](const GroupTable::Slot& s) {
+            groups.Add((uint64_t{ toGlobal[CouponOfKey(s.mKey)] } << 32) | static_cast<uint32_t>(s.mKey), s.mSum, s.mCount);
+        });
+    }
+    coupons.resize(couponCodes.size());
+    for (const auto& [name, code] : couponCodes)
+        coupons[code] = name;
+
+    std::vector<GroupResult> results;
+    results.reserve(groups.Size());
+    groups.ForEach([&results, &coupons](const GroupTable::Slot& s) {
+        results.push_back({ coupons[CouponOfKey(s.mKey)], YearOfKey(s.mKey), MonthOfKey(s.mKey), s.mCount, s.mSum });
+    });
+    std::sort(results.begin(), results.end(), [](const GroupResult& a, const GroupResult& b) {
+        return std::tie(a.mCoupon, a.mYear, a.mMonth) < std::tie(b.mCoupon, b.mYear, b.mMonth);
+    });
+    return results;
+}
+
+void ShowResults(const std::vector<GroupResult>& results, Date startDate, Date endDate) {
+    constexpr std::string_view NoCoupon = "(no coupon)";
+    const size_t maxStringLen = std::accumulate(std::cbegin(results), std::cend(results), NoCoupon.length(),
+        [](size_t l, const auto &result) { return std::max(l, result.mCoupon.length()); }
+    );
+
+    std::cout << std::setw(maxStringLen + 1) << std::left << "Coupon" << " | " << std::setw(8) << "Month" << " | " << std::setw(10) << "Orders";
+    if (!startDate.IsInvalid() && !endDate.IsInvalid())
+        std::cout << " | Total Orders Value between " << startDate << " and " << endDate << '\n';
+    else if (!startDate.IsInvalid())
+        std::cout << " | Total Orders Value since " << startDate << '\n';
+    else
+        std::cout << " | Total Orders Value\n";
+
+    for (const auto& [coupon, year, month, orders, sum] : results) {
+        const auto monthLabel = std::to_string(month) + DEFAULT_DATE_DELIM + std::to_string(year);
+        std::cout << std::setw(maxStringLen + 1) << std::left << (coupon.empty() ? NoCoupon : std::string_view(coupon))
+                  << " | " << std::setw(8) << monthLabel << " | " << std::setw(10) << orders
+                  << " | " << std::fixed << std::setprecision(2) << sum << '\n';
+    }
+
+    ScopeTimer::ShowStoredResults();
+}
+
+// "startDate:endDate", a side might be empty for no limit
+[[nodiscard]] QueryRange ParseRange(std::string_view text) {
+    const auto colon = text.find(':');
+    if (colon == std::string_view::npos)
+        throw std::runtime_error("Cannot convert date range from " + std::string(text) + ", expected startDate:endDate");
+
+    const auto startText = text.substr(0, colon);
+    const auto endText = text.substr(colon + 1);
+    const Date startDate = startText.empty() ? Date() : Date(startText);
+    const Date endDate = endText.empty() ? Date() : Date(endText);
+    return { std::string(text), ToDayRange(startDate, endDate) };
+}
+
+// a range for every month of the year
+[[nodiscard]] std::vector<QueryRange> MonthRanges(std::string_view yearText) {
+    const auto year = TryConvert<uint16_t>(yearText).value_or(0);
+    if (year == 0)
+        throw std::runtime_error("Cannot convert year from " + std::string(yearText));
+
+    std::vector<QueryRange> ranges;
+    for (uint8_t month = 1; month <= 12; ++month) {
+        ranges.push_back({ std::to_string(month) + DEFAULT_DATE_DELIM + std::to_string(year),
+                           ToDayRange(Date(1, month, year), Date(31, month, year)) });
+    }
+    return ranges;
+}
+
+void ShowRangeResults(const std::vector<RangeResult>& results, const std::vector<QueryRange>& ranges) {
+    const size_t maxStringLen = std::accumulate(std::cbegin(results), std::cend(results), size_t{ 12 },
+        [](size_t l, const auto &result) { return std::max(l, result.mFilename.length()); }
+    );
+
+    std::vector<int> widths(ranges.size());
+    std::transform(ranges.begin(), ranges.end(), widths.begin(), [](const QueryRange& r) { return static_cast<int>(std::max<size_t>(r.mLabel.length(), 14)); });
+
+    std::cout << std::setw(maxStringLen + 1) << std::left << "Name Of File" << " | " << std::setw(10) << "Time (ms)";
+    for (size_t i = 0; i < ranges.size(); ++i)
+        std::cout << " | " << std::setw(widths[i]) << ranges[i].mLabel;
+    std::cout << '\n';
+
+    for (const auto&[fileName, sums, ms] : results) {
+        std::cout << std::setw(maxStringLen + 1) << std::left << fileName << " | " << std::fixed << std::setprecision(2) << std::setw(10) << ms;
+        for (size_t i = 0; i < sums.size(); ++i)
+            std::cout << " | " << std::setw(widths[i]) << sums[i];
+        std::cout << '\n';
+    }
 
     ScopeTimer::ShowStoredResults();
 }
 
 int main(int argc, const char** argv) {
-    if (argc <= 1) {
-        std::cerr << "path (startDate) (endDate)\n";
+    // switches might go anywhere, the rest are the positional arguments
+    InputOptions input;
+    BadLineReport badLines;
+    bool scanBenchmark = false;
+    bool groupBy = false;
+    std::string_view tracePath;
+    std::string_view monthlyYear;
+    std::vector<std::string_view> rangeArgs;
+    std::vector<std::string_view> args;
+    bool badSwitch = false; // a switch with a value that can't be used, shows the usage
+    // the value of arg after prefix, one char or "tab" if allowed
+    const auto switchChar = [&badSwitch](std::string_view arg, std::string_view prefix, bool allowTab) {
+        const auto value = arg.substr(prefix.size());
+        if (allowTab && value == "tab")
+            return '\t';
+        if (value.size() != 1) {
+            std::cerr << "wrong switch " << arg << ", expected a single char\n";
+            badSwitch = true;
+        }
+        return value.empty() ? '\0' : value.front();
+    };
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{ argv[i] };
+        if (arg == "--stream")
+            input.mMode = InputMode::Streaming;
+        else if (arg == "--cache")
+            input.mUseCache = true;
+        else if (arg == "--header")
+            input.mDialect.mHeader = true;
+        else if (arg.starts_with("--delim="))
+            input.mDialect.mDelim = switchChar(arg, "--delim=", /*allowTab*/true);
+        else if (arg.starts_with("--quote="))
+            input.mDialect.mQuote = switchChar(arg, "--quote=", /*allowTab*/false);
+        else if (arg == "--skip-bad-lines")
+            input.mBadLines = &badLines;
+        else if (arg == "--group-by")
+            groupBy = true;
+        else if (arg == "--scan-bench")
+            scanBenchmark = true;
+        else if (arg.starts_with("--trace="))
+            tracePath = arg.substr(std::strlen("--trace="));
+        else if (arg.starts_with("--range="))
+            rangeArgs.push_back(arg.substr(std::strlen("--range=")));
+        else if (arg.starts_with("--monthly="))
+            monthlyYear = arg.substr(std::strlen("--monthly="));
+        else if (arg.starts_with("--block-kb="))
+            input.mBlockSize = TryConvert<size_t>(arg.substr(std::strlen("--block-kb="))).value_or(0) * 1024;
+        else
+            args.push_back(arg);
+    }
+
+    // the scanner couldn't tell a quote from a delimiter
+    if (input.mDialect.mDelim == input.mDialect.mQuote) {
+        std::cerr << "the delimiter and the quote must be different chars\n";
+        badSwitch = true;
+    }
+
+    if (args.empty() || input.mBlockSize == 0 || badSwitch) {
+        std::cerr << "path (startDate) (endDate) [--stream] [--block-kb=size] [--cache] [--scan-bench] [--trace=file.json]\n"
+                  << "path (startDate) (endDate) --group-by [--stream] [--block-kb=size] [--cache] [--trace=file.json]\n"
+                  << "path [--range=startDate:endDate]... [--monthly=year] [--stream] [--block-kb=size] [--cache] [--trace=file.json]\n"
+                  << "in every mode: [--delim=c|tab] [--quote=c] [--header] [--skip-bad-lines], the delimiter and the quote are single different chars\n";
         return 1;
     }
 
     try {
-        const auto paths = CollectPaths(argv[1]);
+        const auto paths = CollectPaths(args[0]);
 
         if (paths.empty()){
             std::cout << "No files to process...\n";
             return 0;
         }
 
-        const Date startDate = argc > 2 ? Date(argv[2]) : Date();
-        const Date endDate = argc > 3 ? Date(argv[3]) : Date();
+        if (scanBenchmark) {
+            BenchmarkScanners(paths, input.mDialect);
+            return 0;
+        }
+
+        if (!tracePath.empty())
+            ScopeTimer::EnableTrace();
+
+        if (!rangeArgs.empty() || !monthlyYear.empty()) {
+            auto ranges = monthlyYear.empty() ? std::vector<QueryRange>{ } : MonthRanges(monthlyYear);
+            std::transform(rangeArgs.begin(), rangeArgs.end(), std::back_inserter(ranges), ParseRange);
+
+            const auto results = CalcRangeResults(paths, ranges, input);
+
+            ShowRangeResults(results, ranges);
+        }
+        else {
+            const Date startDate = args.size() > 1 ? Date(args[1]) : Date();
+            const Date endDate = args.size() > 2 ? Date(args[2]) : Date();
+
+            if (groupBy) {
+                const auto results = CalcGroupResults(paths, startDate, endDate, input);
+
+                ShowResults(results, startDate, endDate);
+            }
+            else {
+                const auto results = CalcResults(paths, startDate, endDate, input);
+
+                ShowResults(results, startDate, endDate);
+            }
+        }
 
-        const auto results = CalcResults(paths, startDate, endDate);
+        if (input.mBadLines)
+            input.mBadLines->Show();
 
-        ShowResults(results, startDate, endDate);
+        if (!tracePath.empty())
+            ScopeTimer::WriteTrace(std::string(tracePath));
     }
     catch (const fs::filesystem_error& err) {
         std::cerr << "filesystem error! " << err.what() << '\n';
@@ -0,0 +1,239 @@
+#ifndef CSV_SCANNER_H
+#define CSV_SCANNER_H
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "../../common/cpu_features.h"
+
+// how the CSV text is written, RFC 4180 quoting: a field in quotes may contain the delimiter,
+// new lines and quotes written twice
+struct CsvDialect {
+    char mDelim{ ';' };
+    char mQuote{ '"' };
+    bool mHeader{ false }; // the first line has the column names
+};
+
+// the field without the quotes around it, quotes written twice inside are left as they are
+[[nodiscard]] inline std::string_view StripQuotes(std::string_view field, char quote) noexcept {
+    if (field.size() >= 2 && field.front() == quote && field.back() == quote)
+        return field.substr(1, field.size() - 2);
+    return field;
+}
+
+enum class ScanKernel { Scalar, Sse2, Avx2 };
+
+inline const char* ToString(ScanKernel kernel) {
+    switch (kernel) {
+    case ScanKernel::Sse2: return "SSE2";
+    case ScanKernel::Avx2: return "AVX2";
+    default: return "scalar";
+    }
+}
+
+// the widest kernel the CPU can run
+inline ScanKernel BestScanKernel() {
+    if (cpu::HasAvx2())
+        return ScanKernel::Avx2;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    return ScanKernel::Sse2;
+#else
+    return ScanKernel::Scalar;
+#endif
+}
+
+// Structural index of a block of CSV text: the end offset of every field and
+// where every line ends. One pass finds all delimiters and new lines with
+// SIMD compares and movemask bitmaps, 16 or 32 bytes at a time. The index
+// keeps its memory between Build() calls, so a parser that reuses it doesn't
+// allocate per block or per line.
+// Blocks with quotes also get a mask of the bytes inside of quotes: the prefix
+// XOR of the quote bits, carried over from one chunk to the next. Delimiters and
+// new lines under the mask aren't structural. Blocks without quotes (checked with
+// one memchr) run the plain kernels.
+class FieldIndex {
+public:
+    // offsets are 32 bit, split larger inputs into blocks
+    static constexpr size_t MaxBlockSize = std::numeric_limits<uint32_t>::max();
+
+    // Unless final is set, the data might end in the middle of a record: only the
+    // complete records are indexed and Consumed() says where the next block starts.
+    // The last record of the final block doesn't need a new line.
+    void Build(std::string_view data, const CsvDialect& dialect, bool final = true, ScanKernel kernel = BestScanKernel()) {
+        if (data.size() >= MaxBlockSize)
+            throw std::runtime_error("CSV block is too large to index");
+        if (dialect.mDelim == dialect.mQuote)
+            throw std::runtime_error("The CSV delimiter and quote must be different chars");
+
+        mData = data;
+        mFieldEnds.clear();
+        mLineEnds.clear();
+
+        const bool quoted = !data.empty() && std::memchr(data.data(), dialect.mQuote, data.size()) != nullptr;
+        switch (kernel) {
+#ifdef CPU_X86
+        case ScanKernel::Avx2: quoted ? ScanAvx2<true>(dialect) : ScanAvx2<false>(dialect); break;
+        case ScanKernel::Sse2: quoted ? ScanSse2<true>(dialect) : ScanSse2<false>(dialect); break;
+#endif
+        default: ScanScalar(0, dialect, false); break;
+        }
+
+        const size_t lastLineEnd = mLineEnds.empty() ? 0 : mFieldEnds[mLineEnds.back() - 1] + 1;
+        if (final) {
+            if (lastLineEnd < data.size())
+                AddLineEnd(static_cast<uint32_t>(data.size()));
+            mConsumed = data.size();
+        }
+        else {
+            mFieldEnds.resize(mLineEnds.empty() ? 0 : mLineEnds.back()); // fields of the cut record
+            mConsumed = lastLineEnd;
+        }
+    }
+
+    // the bytes of the complete records in the data of Build()
+    size_t Consumed() const noexcept { return mConsumed; }
+
+    size_t NumLines() const noexcept { return mLineEnds.size(); }
+
+    // same as SplitString: a delimiter at the end of the line doesn't start
+    // another (empty) field, and an empty line has no fields
+    size_t NumFields(size_t line) const noexcept {
+        const auto first = FirstField(line);
+        const auto last = mLineEnds[line] - 1;
+        const size_t lastStart = last == first ? LineStart(line) : mFieldEnds[last - 1] + 1;
+        return last - first + (FieldEnd(last) > lastStart ? 1 : 0);
+    }
+
+    // the line without the new line chars
+    std::string_view Line(size_t line) const noexcept {
+        const auto start = LineStart(line);
+        return mData.substr(start, FieldEnd(mLineEnds[line] - 1) - start);
+    }
+
+    // Fills out with the fields of the line and returns the number of fields
+    // in the line, which might be more than out.size()
+    size_t GetFields(size_t line, std::span<std::string_view> out) const noexcept {
+        const auto first = FirstField(line);
+        const auto count = NumFields(line);
+        size_t start = LineStart(line);
+        for (size_t i = 0; i < count && i < out.size(); ++i) {
+            const auto end = FieldEnd(first + i);
+            out[i] = mData.substr(start, end - start);
+            start = mFieldEnds[first + i] + 1;
+        }
+        return count;
+    }
+
+private:
+    size_t FirstField(size_t line) const noexcept { return line == 0 ? 0 : mLineEnds[line - 1]; }
+    size_t LineStart(size_t line) const noexcept { return line == 0 ? 0 : mFieldEnds[mLineEnds[line - 1] - 1] + 1; }
+
+    // position of the separator, without the '\r' of Windows line ends
+    size_t FieldEnd(size_t field) const noexcept {
+        const size_t end = mFieldEnds[field];
+        return end > 0 && mData[end - 1] == '\r' && (end == mData.size() || mData[end] == '\n') ? end - 1 : end;
+    }
+
+    void AddLineEnd(uint32_t pos) {
+        mFieldEnds.push_back(pos);
+        mLineEnds.push_back(static_cast<uint32_t>(mFieldEnds.size()));
+    }
+
+    // bits of mask are the delimiters and new lines in the 16/32 bytes starting at base
+    void AddMatches(size_t base, uint32_t mask, uint32_t newLineMask) {
+        while (mask != 0) {
+            const auto bit = std::countr_zero(mask);
+            const auto pos = static_cast<uint32_t>(base + bit);
+            if (newLineMask & (1u << bit))
+                AddLineEnd(pos);
+            else
+                mFieldEnds.push_back(pos);
+            mask &= mask - 1;
+        }
+    }
+
+    // inQuotes: the state at from, quotes are checked only when the block has any
+    void ScanScalar(size_t from, const CsvDialect& dialect, bool inQuotes) {
+        for (size_t i = from; i < mData.size(); ++i) {
+            if (mData[i] == dialect.mQuote)
+                inQuotes = !inQuotes;
+            else if (inQuotes)
+                continue;
+            else if (mData[i] == '\n')
+                AddLineEnd(static_cast<uint32_t>(i));
+            else if (mData[i] == dialect.mDelim)
+                mFieldEnds.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    // bit i is set when byte i is inside of quotes, an opening quote is inside, a closing one is not
+    static uint32_t InsideQuotes(uint32_t quoteBits, uint32_t& carry, int bits) noexcept {
+        auto inside = quoteBits;
+        for (int shift = 1; shift < bits; shift *= 2)
+            inside ^= inside << shift;
+        inside ^= carry;
+        carry = (inside >> (bits - 1)) & 1 ? ~uint32_t{ 0 } : 0; // the state after the chunk
+        return inside;
+    }
+
+#ifdef CPU_X86
+    template <bool Quoted>
+    void ScanSse2(const CsvDialect& dialect) {
+        const auto delims = _mm_set1_epi8(dialect.mDelim);
+        const auto newLines = _mm_set1_epi8('\n');
+        const auto quotes = _mm_set1_epi8(dialect.mQuote);
+        uint32_t carry = 0;
+        size_t i = 0;
+        for (; i + 16 <= mData.size(); i += 16) {
+            const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mData.data() + i));
+            auto nl = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newLines)));
+            auto dl = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, delims)));
+            if constexpr (Quoted) {
+                const auto qt = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quotes)));
+                const auto inside = InsideQuotes(qt, carry, 16);
+                nl &= ~inside;
+                dl &= ~inside;
+            }
+            AddMatches(i, nl | dl, nl);
+        }
+        ScanScalar(i, dialect, carry != 0);
+    }
+
+    template <bool Quoted>
+    CPU_TARGET("avx2") void ScanAvx2(const CsvDialect& dialect) {
+        const auto delims = _mm256_set1_epi8(dialect.mDelim);
+        const auto newLines = _mm256_set1_epi8('\n');
+        const auto quotes = _mm256_set1_epi8(dialect.mQuote);
+        uint32_t carry = 0;
+        size_t i = 0;
+        for (; i + 32 <= mData.size(); i += 32) {
+            const auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mData.data() + i));
+            auto nl = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newLines)));
+            auto dl = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, delims)));
+            if constexpr (Quoted) {
+                const auto qt = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quotes)));
+                const auto inside = InsideQuotes(qt, carry, 32);
+                nl &= ~inside;
+                dl &= ~inside;
+            }
+            AddMatches(i, nl | dl, nl);
+        }
+        ScanScalar(i, dialect, carry != 0);
+    }
+#endif
+
+    std::string_view mData;
+    std::vector<uint32_t> mFieldEnds; // delimiter or new line position of every field
+    std::vector<uint32_t> mLineEnds; // one past the last field of every line, index into mFieldEnds
+    size_t mConsumed{ 0 };
+};
+
+#endif // CSV_SCANNER_H
@@ -0,0 +1,113 @@
+#ifndef DATE_INDEX_H
+#define DATE_INDEX_H
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "order_table.h"
+
+// closed range of date keys, see Date::Packed()
+struct DayRange {
+    int32_t mFirstDay{ 0 };
+    int32_t mLastDay{ 0 };
+};
+
+// Order values summed per day, with prefix sums over the sorted days, so the total of
+// any date range is two binary searches and a subtraction instead of a pass over all
+// rows. One index answers any number of ranges.
+class DateIndex {
+public:
+    DateIndex() = default;
+    explicit DateIndex(const OrderTable& table) { Add(table); }
+
+    // adds the orders of the table, for example of the next block of a file
+    void Add(const OrderTable& table) {
+        const auto days = table.Days();
+        const auto prices = table.UnitPrices();
+        const auto discounts = table.Discounts();
+        const auto quantities = table.Quantities();
+        // the rows usually come in date order, so runs of the same day are summed first
+        std::vector<std::pair<int32_t, double>> runs;
+        double run = 0.0;
+        for (size_t i = 0; i < table.Size(); ++i) {
+            run += quantities[i] * (prices[i] * (1.0 - discounts[i]));
+            if (i + 1 == table.Size() || days[i + 1] != days[i]) {
+                runs.emplace_back(days[i], run);
+                run = 0.0;
+            }
+        }
+        if (runs.empty())
+            return;
+
+        if (!std::is_sorted(runs.begin(), runs.end(), [](const auto& a, const auto& b) { return a.first < b.first; }))
+            std::stable_sort(runs.begin(), runs.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        mPrefix.clear();
+        if (mDays.empty() || mDays.back() < runs.front().first) { // a later block of a file in date order
+            for (const auto& [day, sum] : runs)
+                AddToLast(mDays, mSums, day, sum);
+            return;
+        }
+
+        std::vector<int32_t> mergedDays;
+        std::vector<double> mergedSums;
+        mergedDays.reserve(mDays.size() + runs.size());
+        mergedSums.reserve(mDays.size() + runs.size());
+        size_t i = 0;
+        for (const auto& [day, sum] : runs) {
+            for (; i < mDays.size() && mDays[i] <= day; ++i)
+                AddToLast(mergedDays, mergedSums, mDays[i], mSums[i]);
+            AddToLast(mergedDays, mergedSums, day, sum);
+        }
+        for (; i < mDays.size(); ++i)
+            AddToLast(mergedDays, mergedSums, mDays[i], mSums[i]);
+        mDays = std::move(mergedDays);
+        mSums = std::move(mergedSums);
+    }
+
+    size_t NumDays() const noexcept { return mDays.size(); }
+
+    // the first query after Add() builds the prefix sums, so that one must not run concurrently with others
+    double Sum(DayRange range) const {
+        if (range.mLastDay < range.mFirstDay)
+            return 0.0;
+        if (mPrefix.size() != mDays.size() + 1)
+            BuildPrefix();
+        const auto first = std::lower_bound(mDays.begin(), mDays.end(), range.mFirstDay) - mDays.begin();
+        const auto last = std::upper_bound(mDays.begin(), mDays.end(), range.mLastDay) - mDays.begin();
+        return mPrefix[last] - mPrefix[first];
+    }
+
+    void Sums(std::span<const DayRange> ranges, std::span<double> out) const {
+        std::transform(ranges.begin(), ranges.end(), out.begin(), [this](DayRange r) { return Sum(r); });
+    }
+
+private:
+    static void AddToLast(std::vector<int32_t>& days, std::vector<double>& sums, int32_t day, double sum) {
+        if (!days.empty() && days.back() == day) {
+            sums.back() += sum;
+        }
+        else {
+            days.push_back(day);
+            sums.push_back(sum);
+        }
+    }
+
+    void BuildPrefix() const {
+        mPrefix.assign(mDays.size() + 1, 0.0);
+        for (size_t i = 0; i < mDays.size(); ++i)
+            mPrefix[i + 1] = mPrefix[i] + mSums[i];
+    }
+
+private:
+    std::vector<int32_t> mDays; // sorted, every day with orders once
+    std::vector<double> mSums;  // total of mDays[i]
+    mutable std::vector<double> mPrefix; // mPrefix[i] is the sum of the days before mDays[i], empty until the first query
+};
+
+#endif // DATE_INDEX_H
@@ -0,0 +1,121 @@
+#ifndef GROUP_BY_H
+#define GROUP_BY_H
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <execution>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "date_index.h" // DayRange
+#include "order_table.h"
+
+// Open addressing hash map (linear probing) from a 64 bit group key to the sum and
+// count of the group. One flat array of slots, so adding a row is a multiply, a shift
+// and usually one cache line.
+class GroupTable {
+public:
+    struct Slot {
+        uint64_t mKey{ EmptyKey };
+        double mSum{ 0.0 };
+        uint64_t mCount{ 0 };
+    };
+
+    static constexpr uint64_t EmptyKey = ~uint64_t{ 0 }; // not a valid key
+
+    size_t Size() const noexcept { return mSize; }
+
+    void Add(uint64_t key, double value, uint64_t count = 1) {
+        if ((mSize + 1) * 2 > mSlots.size()) // at most half full, so the probe sequences stay short
+            Grow();
+
+        auto& slot = FindSlot(mSlots, key);
+        if (slot.mKey == EmptyKey) {
+            slot.mKey = key;
+            ++mSize;
+        }
+        slot.mSum += value;
+        slot.mCount += count;
+    }
+
+    void Merge(const GroupTable& other) {
+        other.ForEach([this](const Slot& s) { Add(s.mKey, s.mSum, s.mCount); });
+    }
+
+    template <typename Func>
+    void ForEach(Func func) const {
+        for (const auto& slot : mSlots) {
+            if (slot.mKey != EmptyKey)
+                func(slot);
+        }
+    }
+
+private:
+    static Slot& FindSlot(std::vector<Slot>& slots, uint64_t key) noexcept {
+        // Fibonacci hashing, the high bits of the product are well mixed
+        const auto mask = slots.size() - 1;
+        const auto shift = 64 - std::countr_zero(slots.size());
+        auto i = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift) & mask;
+        while (slots[i].mKey != EmptyKey && slots[i].mKey != key)
+            i = (i + 1) & mask;
+        return slots[i];
+    }
+
+    void Grow() {
+        std::vector<Slot> slots(std::max<size_t>(16, mSlots.size() * 2));
+        for (const auto& slot : mSlots) {
+            if (slot.mKey != EmptyKey)
+                FindSlot(slots, slot.mKey) = slot;
+        }
+        mSlots.swap(slots);
+    }
+
+    std::vector<Slot> mSlots; // the size is a power of two
+    size_t mSize{ 0 };
+};
+
+// key of a coupon code of the table and a month, (year << 4) | month in the low bits
+[[nodiscard]] constexpr uint64_t CouponMonthKey(uint32_t coupon, int32_t day) noexcept {
+    return (uint64_t{ coupon } << 32) | static_cast<uint32_t>(day >> 5);
+}
+[[nodiscard]] constexpr uint32_t CouponOfKey(uint64_t key) noexcept { return static_cast<uint32_t>(key >> 32); }
+[[nodiscard]] constexpr uint32_t YearOfKey(uint64_t key) noexcept { return static_cast<uint32_t>(key) >> 4; }
+[[nodiscard]] constexpr uint32_t MonthOfKey(uint64_t key) noexcept { return static_cast<uint32_t>(key) & 0xF; }
+
+// Order values of the rows in the date range, grouped by coupon code and month. Every chunk of
+// rows is aggregated into its own table by the task that runs it, and the reduction merges the
+// tables, so no table is shared between threads.
+[[nodiscard]] inline GroupTable GroupByCouponMonth(const OrderTable& table, DayRange range) {
+    constexpr size_t ChunkSize = 64 * 1024;
+
+    const auto days = table.Days();
+    const auto coupons = table.Coupons();
+    const auto prices = table.UnitPrices();
+    const auto discounts = table.Discounts();
+    const auto quantities = table.Quantities();
+
+    std::vector<size_t> chunks((table.Size() + ChunkSize - 1) / ChunkSize);
+    std::iota(chunks.begin(), chunks.end(), size_t{ 0 });
+    return std::transform_reduce(std::execution::par, chunks.begin(), chunks.end(), GroupTable{ },
+        [](GroupTable a, GroupTable b) {
+            if (a.Size() < b.Size())
+                std::swap(a, b);
+            a.Merge(b);
+            return a;
+        },
+        [&](size_t chunk) {
+            GroupTable groups;
+            const size_t last = std::min((chunk + 1) * ChunkSize, table.Size());
+            for (size_t i = chunk * ChunkSize; i < last; ++i) {
+                if (days[i] >= range.mFirstDay && days[i] <= range.mLastDay)
+                    groups.Add(CouponMonthKey(coupons[i], days[i]), quantities[i] * (prices[i] * (1.0 - discounts[i])));
+            }
+            return groups;
+        });
+}
+
+#endif // GROUP_BY_H
@@ -0,0 +1,127 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#pragma once
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read only memory mapping of a whole file. View() points straight into the
+// mapping, so string_views created from it stay valid as long as the
+// MappedFile lives and nothing is copied into a buffer.
+// The mapping is marked for sequential access, so the OS reads ahead aggressively
+// and drops pages behind the reader.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path& filePath) {
+#ifdef _WIN32
+        const auto hFile = ::CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Cannot open " + filePath.filename().string());
+
+        LARGE_INTEGER fileSize{};
+        ::GetFileSizeEx(hFile, &fileSize);
+        mSize = static_cast<size_t>(fileSize.QuadPart);
+        if (mSize == 0) { // empty files cannot be mapped
+            ::CloseHandle(hFile);
+            return;
+        }
+
+        const auto hMapping = ::CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        ::CloseHandle(hFile);
+        if (!hMapping)
+            throw std::runtime_error("Cannot map " + filePath.filename().string());
+
+        // the view keeps the mapping alive
+        mData = static_cast<const char*>(::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+        ::CloseHandle(hMapping);
+        if (!mData)
+            throw std::runtime_error("Cannot map " + filePath.filename().string());
+#else
+        const int fd = ::open(filePath.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open " + filePath.filename().string());
+
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot read the size of " + filePath.filename().string());
+        }
+
+        mSize = static_cast<size_t>(st.st_size);
+        if (mSize == 0) { // empty files cannot be mapped
+            ::close(fd);
+            return;
+        }
+
+        // the mapping stays valid after closing the descriptor
+        const auto pView = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (pView == MAP_FAILED)
+            throw std::runtime_error("Cannot map " + filePath.filename().string());
+
+        ::madvise(pView, mSize, MADV_SEQUENTIAL);
+        mData = static_cast<const char*>(pView);
+#endif
+    }
+
+    ~MappedFile() { Unmap(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept
+        : mData(std::exchange(other.mData, nullptr)), mSize(std::exchange(other.mSize, 0)) { }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            Unmap();
+            mData = std::exchange(other.mData, nullptr);
+            mSize = std::exchange(other.mSize, 0);
+        }
+        return *this;
+    }
+
+    std::string_view View() const noexcept { return { mData, mData ? mSize : 0 }; }
+    size_t Size() const noexcept { return mSize; }
+
+    // Pages are loaded lazily on the first access. Touching one byte per page
+    // does the disk reads here, so they can be timed apart from the parsing.
+    void Prefault() const noexcept {
+        constexpr size_t PageStep = 4096;
+        volatile char sink = 0;
+        for (size_t i = 0; i < View().size(); i += PageStep)
+            sink = sink + mData[i];
+    }
+
+private:
+    void Unmap() noexcept {
+        if (!mData)
+            return;
+#ifdef _WIN32
+        ::UnmapViewOfFile(mData);
+#else
+        ::munmap(const_cast<char*>(mData), mSize);
+#endif
+        mData = nullptr;
+        mSize = 0;
+    }
+
+    const char* mData{ nullptr };
+    size_t mSize{ 0 };
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,319 @@
+#ifndef ORDER_TABLE_H
+#define ORDER_TABLE_H
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "csv_scanner.h" // ScanKernel and the AVX2 target macro
+#include "mapped_file.h"
+
+// Columnar store of the orders: one array per column, so the date filter and
+// the price math only stream through the columns they use. Dates are int32
+// keys that compare like the dates, coupon codes are indices into a
+// dictionary of the distinct codes, so the table owns all of its data.
+// The columns either live in vectors, or point into a mapped image written
+// by SaveImage(); appending to a mapped table copies it into vectors first.
+class OrderTable {
+public:
+    // what the image was made from, a different key means the image is stale
+    struct ImageKey {
+        uint64_t mSourceSize{ 0 };
+        int64_t mSourceTime{ 0 }; // last_write_time ticks
+        std::string mSourceName;
+        uint32_t mParseOptions{ 0 }; // anything else that changes the parsed values
+    };
+
+    size_t Size() const noexcept { return IsMapped() ? mMappedRows : mDays.size(); }
+
+    // drops the rows, the coupon dictionary is kept
+    void Clear() noexcept {
+        mImage = MappedFile{ };
+        mMappedRows = 0;
+        mDays.clear();
+        mCoupons.clear();
+        mUnitPrices.clear();
+        mDiscounts.clear();
+        mQuantities.clear();
+    }
+
+    void Append(int32_t day, std::string_view coupon, double unitPrice, double discount, uint32_t quantity) {
+        Detach();
+        mDays.push_back(day);
+        mCoupons.push_back(InternCoupon(coupon));
+        mUnitPrices.push_back(unitPrice);
+        mDiscounts.push_back(discount);
+        mQuantities.push_back(quantity);
+    }
+
+    std::span<const int32_t> Days() const noexcept { return { Cols().mDays, Size() }; }
+    std::span<const uint32_t> Coupons() const noexcept { return { Cols().mCoupons, Size() }; }
+    std::span<const double> UnitPrices() const noexcept { return { Cols().mUnitPrices, Size() }; }
+    std::span<const double> Discounts() const noexcept { return { Cols().mDiscounts, Size() }; }
+    std::span<const uint32_t> Quantities() const noexcept { return { Cols().mQuantities, Size() }; }
+
+    size_t NumCoupons() const noexcept { return mCouponNames.size(); }
+    std::string_view CouponName(uint32_t code) const noexcept { return mCouponNames[code]; }
+
+    // Sum of quantity * unitPrice * (1 - discount) of the rows with firstDay <= day <= lastDay.
+    // Chunks of rows are summed in parallel, each with a branch-free loop.
+    double SumOrders(int32_t firstDay, int32_t lastDay, ScanKernel kernel = BestScanKernel()) const {
+        constexpr size_t ChunkSize = 64 * 1024;
+
+        const auto cols = Cols();
+        const auto rows = Size();
+        std::vector<size_t> chunks((rows + ChunkSize - 1) / ChunkSize);
+        std::iota(chunks.begin(), chunks.end(), size_t{ 0 });
+        return std::transform_reduce(std::execution::par, chunks.begin(), chunks.end(), 0.0, std::plus<>(),
+            [&cols, rows, firstDay, lastDay, kernel](size_t chunk) {
+                const size_t first = chunk * ChunkSize;
+                const size_t last = std::min(first + ChunkSize, rows);
+#ifdef CPU_X86
+                if (kernel == ScanKernel::Avx2)
+                    return SumAvx2(cols, first, last, firstDay, lastDay);
+#endif
+                return SumScalar(cols, first, last, firstDay, lastDay);
+            });
+    }
+
+    // Image layout, all in native byte order:
+    // header | unit prices | discounts | days | coupons | quantities | coupon name lengths | coupon names
+    // The header and the column sizes keep every column aligned to its type.
+    void SaveImage(const std::filesystem::path& path, const ImageKey& key) const {
+        ImageHeader header;
+        header.mSourceSize = key.mSourceSize;
+        header.mSourceTime = key.mSourceTime;
+        header.mRows = Size();
+        header.mNumCoupons = static_cast<uint32_t>(NumCoupons());
+        header.mParseOptions = key.mParseOptions;
+        header.mNameLength = static_cast<uint32_t>(std::min(key.mSourceName.size(), sizeof(header.mSourceName)));
+        std::memcpy(header.mSourceName, key.mSourceName.data(), header.mNameLength);
+
+        // written next to the target and renamed, so a reader never sees half of an image
+        auto tmpPath = path;
+        tmpPath += ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+                throw std::runtime_error("Cannot write " + tmpPath.string());
+
+            const auto write = [&out](const auto* data, size_t count) {
+                out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(*data)));
+            };
+            const auto cols = Cols();
+            write(&header, 1);
+            write(cols.mUnitPrices, Size());
+            write(cols.mDiscounts, Size());
+            write(cols.mDays, Size());
+            write(cols.mCoupons, Size());
+            write(cols.mQuantities, Size());
+            for (const auto& name : mCouponNames) {
+                const auto len = static_cast<uint32_t>(name.size());
+                write(&len, 1);
+            }
+            for (const auto& name : mCouponNames)
+                write(name.data(), name.size());
+
+            if (!out)
+                throw std::runtime_error("Cannot write " + tmpPath.string());
+        }
+        std::filesystem::rename(tmpPath, path);
+    }
+
+    // the table of the image at path, or nullopt if there's no image, it's damaged
+    // or it was made from another version of the source
+    [[nodiscard]] static std::optional<OrderTable> LoadImage(const std::filesystem::path& path, const ImageKey& key) {
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec))
+            return std::nullopt;
+
+        OrderTable table;
+        table.mImage = MappedFile{ path };
+        const auto image = table.mImage.View();
+        if (image.size() < sizeof(ImageHeader))
+            return std::nullopt;
+
+        ImageHeader header;
+        std::memcpy(&header, image.data(), sizeof(header));
+        if (header.mMagic != ImageMagic || header.mVersion != ImageVersion ||
+            header.mSourceSize != key.mSourceSize || header.mSourceTime != key.mSourceTime || header.mParseOptions != key.mParseOptions ||
+            std::string_view(header.mSourceName, std::min<size_t>(header.mNameLength, sizeof(header.mSourceName))) !=
+                std::string_view(key.mSourceName).substr(0, sizeof(header.mSourceName)))
+            return std::nullopt;
+
+        const size_t rows = header.mRows;
+        const size_t namesOffset = sizeof(ImageHeader) + rows * RowBytes;
+        if (rows > image.size() / RowBytes || namesOffset + header.mNumCoupons * sizeof(uint32_t) > image.size())
+            return std::nullopt;
+
+        const char* pNames = image.data() + namesOffset + header.mNumCoupons * sizeof(uint32_t);
+        const char* const pEnd = image.data() + image.size();
+        for (uint32_t i = 0; i < header.mNumCoupons; ++i) {
+            uint32_t len = 0;
+            std::memcpy(&len, image.data() + namesOffset + i * sizeof(uint32_t), sizeof(len));
+            if (len > static_cast<size_t>(pEnd - pNames))
+                return std::nullopt;
+            const auto& name = table.mCouponNames.emplace_back(pNames, len);
+            table.mCouponCodes.emplace(name, i);
+            pNames += len;
+        }
+
+        table.mMappedRows = rows;
+
+        // CouponName() indexes the names with the stored codes without a check
+        const auto coupons = table.Coupons();
+        if (std::any_of(coupons.begin(), coupons.end(), [numCoupons = header.mNumCoupons](uint32_t code) { return code >= numCoupons; }))
+            return std::nullopt;
+
+        return table;
+    }
+
+private:
+    static constexpr uint32_t ImageMagic = 0x4356534f; // "OSVC" in little endian, doesn't match in the other byte order
+    static constexpr uint32_t ImageVersion = 2;
+    static constexpr size_t RowBytes = 2 * sizeof(double) + 3 * sizeof(uint32_t);
+
+    struct ImageHeader {
+        uint32_t mMagic{ ImageMagic };
+        uint32_t mVersion{ ImageVersion };
+        uint64_t mSourceSize{ 0 };
+        int64_t mSourceTime{ 0 };
+        uint64_t mRows{ 0 };
+        uint32_t mNumCoupons{ 0 };
+        uint32_t mNameLength{ 0 };
+        uint32_t mParseOptions{ 0 };
+        uint32_t mReserved{ 0 };
+        char mSourceName[224]{ };
+    };
+    static_assert(sizeof(ImageHeader) % alignof(double) == 0);
+
+    struct Columns {
+        const int32_t* mDays;
+        const uint32_t* mCoupons;
+        const double* mUnitPrices;
+        const double* mDiscounts;
+        const uint32_t* mQuantities;
+    };
+
+    bool IsMapped() const noexcept { return mImage.Size() > 0; }
+
+    Columns Cols() const noexcept {
+        if (!IsMapped())
+            return { mDays.data(), mCoupons.data(), mUnitPrices.data(), mDiscounts.data(), mQuantities.data() };
+
+        const char* p = mImage.View().data() + sizeof(ImageHeader);
+        const auto rows = mMappedRows;
+        const auto pPrices = reinterpret_cast<const double*>(p);
+        const auto pDiscounts = pPrices + rows;
+        const auto pDays = reinterpret_cast<const int32_t*>(pDiscounts + rows);
+        const auto pCoupons = reinterpret_cast<const uint32_t*>(pDays + rows);
+        const auto pQuantities = pCoupons + rows;
+        return { pDays, pCoupons, pPrices, pDiscounts, pQuantities };
+    }
+
+    // copies the mapped columns into the vectors, so rows can be added
+    void Detach() {
+        if (!IsMapped())
+            return;
+
+        const auto cols = Cols();
+        const auto rows = mMappedRows;
+        mDays.assign(cols.mDays, cols.mDays + rows);
+        mCoupons.assign(cols.mCoupons, cols.mCoupons + rows);
+        mUnitPrices.assign(cols.mUnitPrices, cols.mUnitPrices + rows);
+        mDiscounts.assign(cols.mDiscounts, cols.mDiscounts + rows);
+        mQuantities.assign(cols.mQuantities, cols.mQuantities + rows);
+        mImage = MappedFile{ };
+        mMappedRows = 0;
+    }
+
+    static double RowValue(const Columns& cols, size_t i, int32_t firstDay, int32_t lastDay) noexcept {
+        const bool inRange = (cols.mDays[i] >= firstDay) & (cols.mDays[i] <= lastDay);
+        const double value = cols.mQuantities[i] * (cols.mUnitPrices[i] * (1.0 - cols.mDiscounts[i]));
+        return inRange ? value : 0.0;
+    }
+
+    // four independent sums, the compiler doesn't have to keep the order of additions
+    static double SumScalar(const Columns& cols, size_t first, size_t last, int32_t firstDay, int32_t lastDay) noexcept {
+        double sums[4]{ };
+        size_t i = first;
+        for (; i + 4 <= last; i += 4) {
+            for (size_t k = 0; k < 4; ++k)
+                sums[k] += RowValue(cols, i + k, firstDay, lastDay);
+        }
+        for (; i < last; ++i)
+            sums[0] += RowValue(cols, i, firstDay, lastDay);
+        return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    }
+
+#ifdef CPU_X86
+    // four rows per step: the int32 date compares are widened to a 64 bit mask
+    // that clears the values of the rows outside of the range
+    CPU_TARGET("avx2") static double SumAvx2(const Columns& cols, size_t first, size_t last, int32_t firstDay, int32_t lastDay) noexcept {
+        const auto lo = _mm_set1_epi32(firstDay);
+        const auto hi = _mm_set1_epi32(lastDay);
+        const auto ones = _mm256_set1_pd(1.0);
+        // uint32 -> double: flip the sign bit, convert as int32 and add 2^31 back
+        const auto signBit = _mm_set1_epi32(INT32_MIN);
+        const auto two31 = _mm256_set1_pd(2147483648.0);
+
+        auto sum = _mm256_setzero_pd();
+        size_t i = first;
+        for (; i + 4 <= last; i += 4) {
+            const auto days = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cols.mDays + i));
+            const auto outside = _mm_or_si128(_mm_cmplt_epi32(days, lo), _mm_cmpgt_epi32(days, hi));
+            const auto mask = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(outside));
+
+            const auto quantity32 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cols.mQuantities + i));
+            const auto quantity = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(quantity32, signBit)), two31);
+            const auto price = _mm256_loadu_pd(cols.mUnitPrices + i);
+            const auto discount = _mm256_loadu_pd(cols.mDiscounts + i);
+
+            const auto value = _mm256_mul_pd(quantity, _mm256_mul_pd(price, _mm256_sub_pd(ones, discount)));
+            sum = _mm256_add_pd(sum, _mm256_andnot_pd(mask, value));
+        }
+
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, sum);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + SumScalar(cols, i, last, firstDay, lastDay);
+    }
+#endif
+
+    uint32_t InternCoupon(std::string_view coupon) {
+        if (const auto it = mCouponCodes.find(coupon); it != mCouponCodes.end())
+            return it->second;
+
+        const auto code = static_cast<uint32_t>(mCouponNames.size());
+        const auto& name = mCouponNames.emplace_back(coupon);
+        mCouponCodes.emplace(name, code);
+        return code;
+    }
+
+private:
+    std::vector<int32_t> mDays;
+    std::vector<uint32_t> mCoupons;
+    std::vector<double> mUnitPrices;
+    std::vector<double> mDiscounts; // 0... 1.0
+    std::vector<uint32_t> mQuantities;
+
+    MappedFile mImage; // the columns of a loaded image
+    size_t mMappedRows{ 0 };
+
+    std::deque<std::string> mCouponNames; // deque, so the keys of mCouponCodes don't move
+    std::unordered_map<std::string_view, uint32_t> mCouponCodes;
+};
+
+#endif // ORDER_TABLE_H
@@ -3,21 +3,257 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
-// Scope Timer is not thread safe, so use it only on a single thread
+namespace timing {
+
+using Clock = std::chrono::steady_clock;
+
+// count, sum, min/max and a log2 histogram of the durations of one timer name
+struct Stats {
+    static constexpr size_t NumBuckets = 64; // bucket i holds the durations in [2^i, 2^(i+1)) ns
+
+    void Add(int64_t ns) noexcept {
+        const auto value = static_cast<uint64_t>(std::max<int64_t>(ns, 0));
+        ++mCount;
+        mTotalNs += value;
+        mMinNs = std::min(mMinNs, value);
+        mMaxNs = std::max(mMaxNs, value);
+        ++mBuckets[Bucket(value)];
+    }
+
+    // floor(log2(value)), 0 for 0
+    static size_t Bucket(uint64_t value) noexcept {
+        size_t bucket = 0;
+        while (value >>= 1)
+            ++bucket;
+        return bucket;
+    }
+
+    void Merge(const Stats& other) noexcept {
+        mCount += other.mCount;
+        mTotalNs += other.mTotalNs;
+        mMinNs = std::min(mMinNs, other.mMinNs);
+        mMaxNs = std::max(mMaxNs, other.mMaxNs);
+        for (size_t i = 0; i < NumBuckets; ++i)
+            mBuckets[i] += other.mBuckets[i];
+    }
+
+    // approximation, linear inside of the bucket that holds the percentile
+    double PercentileNs(double p) const noexcept {
+        if (mCount == 0)
+            return 0.0;
+
+        const double rank = p / 100.0 * static_cast<double>(mCount);
+        uint64_t below = 0;
+        for (size_t i = 0; i < NumBuckets; ++i) {
+            if (mBuckets[i] == 0 || static_cast<double>(below + mBuckets[i]) < rank) {
+                below += mBuckets[i];
+                continue;
+            }
+            const double lo = i == 0 ? 0.0 : static_cast<double>(uint64_t{ 1 } << i);
+            const double hi = static_cast<double>(uint64_t{ 1 } << i) * 2.0;
+            const double value = lo + (hi - lo) * (rank - static_cast<double>(below)) / static_cast<double>(mBuckets[i]);
+            return std::clamp(value, static_cast<double>(mMinNs), static_cast<double>(mMaxNs));
+        }
+        return static_cast<double>(mMaxNs);
+    }
+
+    uint64_t mCount{ 0 };
+    uint64_t mTotalNs{ 0 };
+    uint64_t mMinNs{ std::numeric_limits<uint64_t>::max() };
+    uint64_t mMaxNs{ 0 };
+    std::array<uint64_t, NumBuckets> mBuckets{ };
+};
+
+struct TraceEvent {
+    uint32_t mName{ 0 };
+    int64_t mStartNs{ 0 }; // since the registry was created
+    int64_t mDurationNs{ 0 };
+};
+
+// Measurements of one thread. Only the owning thread writes, the lock is only
+// contended while a report merges the threads.
+struct ThreadData {
+    uint32_t mThreadId{ 0 };
+    std::mutex mMutex;
+    std::vector<Stats> mStats; // by name id
+    std::vector<TraceEvent> mEvents;
+};
+
+// Names and the per thread data of all threads that measured something. The thread
+// data lives as long as the registry, so reports still see the threads that finished.
+class Registry {
+public:
+    static Registry& Get() {
+        static Registry sRegistry;
+        return sRegistry;
+    }
+
+    uint32_t Intern(std::string_view name) {
+        std::lock_guard lock(mMutex);
+        if (const auto it = std::find(mNames.begin(), mNames.end(), name); it != mNames.end())
+            return static_cast<uint32_t>(it - mNames.begin());
+        mNames.push_back(name);
+        return static_cast<uint32_t>(mNames.size() - 1);
+    }
+
+    // The name has to live as long as the registry, a string literal or __func__. The ids
+    // are cached per thread by the address of the name, so only the first use locks.
+    uint32_t InternStatic(const char* name) {
+        thread_local std::unordered_map<const char*, uint32_t> tIds;
+        const auto it = tIds.find(name);
+        if (it != tIds.end())
+            return it->second;
+        return tIds[name] = Intern(name);
+    }
+
+    std::string_view Name(uint32_t id) {
+        std::lock_guard lock(mMutex);
+        return mNames[id];
+    }
+
+    // the data of the calling thread, registered on the first use
+    ThreadData& ThisThread() {
+        thread_local ThreadData* tData = nullptr;
+        if (!tData) {
+            std::lock_guard lock(mMutex);
+            auto& data = mThreads.emplace_back(std::make_unique<ThreadData>());
+            data->mThreadId = static_cast<uint32_t>(mThreads.size());
+            tData = data.get();
+        }
+        return *tData;
+    }
+
+    void Record(uint32_t name, Clock::time_point start, Clock::time_point end) {
+        const auto startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - mEpoch).count();
+        const auto durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+        auto& data = ThisThread();
+        std::lock_guard lock(data.mMutex);
+        if (data.mStats.size() <= name)
+            data.mStats.resize(name + 1);
+        data.mStats[name].Add(durationNs);
+        if (mTrace.load(std::memory_order_relaxed))
+            data.mEvents.push_back({ name, startNs, durationNs });
+    }
+
+    // keeps every measurement for WriteTrace(), enable it before the measured code runs
+    void EnableTrace(bool enable) noexcept { mTrace.store(enable, std::memory_order_relaxed); }
+
+    // stats of all threads merged, by name
+    std::map<std::string_view, Stats> Merge() {
+        std::lock_guard lock(mMutex);
+        std::map<std::string_view, Stats> merged;
+        for (const auto& data : mThreads) {
+            std::lock_guard threadLock(data->mMutex);
+            for (size_t i = 0; i < data->mStats.size(); ++i) {
+                if (data->mStats[i].mCount > 0)
+                    merged[mNames[i]].Merge(data->mStats[i]);
+            }
+        }
+        return merged;
+    }
+
+    // Chrome trace event format, open it in chrome://tracing or ui.perfetto.dev
+    void WriteTrace(const std::string& path) {
+        std::ofstream out(path);
+        if (!out)
+            throw std::runtime_error("Cannot write the trace to " + path);
+
+        std::lock_guard lock(mMutex);
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        for (const auto& data : mThreads) {
+            std::lock_guard threadLock(data->mMutex);
+            for (const auto& ev : data->mEvents) {
+                out << (first ? "\n" : ",\n") << "{\"name\":\"";
+                for (const char c : mNames[ev.mName]) {
+                    if (c == '"' || c == '\\')
+                        out << '\\';
+                    out << c;
+                }
+                out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << data->mThreadId << std::fixed << std::setprecision(3)
+                    << ",\"ts\":" << static_cast<double>(ev.mStartNs) / 1000.0
+                    << ",\"dur\":" << static_cast<double>(ev.mDurationNs) / 1000.0 << '}';
+                first = false;
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+private:
+    Registry() = default;
+
+    std::mutex mMutex;
+    std::vector<std::string_view> mNames; // the names are string literals
+    std::vector<std::unique_ptr<ThreadData>> mThreads;
+    const Clock::time_point mEpoch{ Clock::now() };
+    std::atomic<bool> mTrace{ false };
+};
+
+// id of a name, "Name"_timer interns the name once per literal, so timers don't hash or allocate strings
+class TimerName {
+public:
+    explicit TimerName(uint32_t id) noexcept : mId(id) { }
+    uint32_t Id() const noexcept { return mId; }
+
+private:
+    uint32_t mId;
+};
+
+// a class type template parameter needs C++20, C++17 code names its timers with a const char*
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+#define SCOPE_TIMER_LITERAL
+template <size_t N>
+struct FixedString {
+    constexpr FixedString(const char (&str)[N]) { std::copy_n(str, N, mStr); }
+    constexpr std::string_view View() const { return { mStr, N - 1 }; }
+
+    char mStr[N]{ };
+};
+#endif
+
+} // namespace timing
+
+#ifdef SCOPE_TIMER_LITERAL
+template <timing::FixedString Name>
+timing::TimerName operator""_timer() {
+    static const uint32_t sId = timing::Registry::Get().Intern(Name.View());
+    return timing::TimerName{ sId };
+}
+#endif
+
+// Measures the scope. Stored measurements go to thread local stats, so timers may run
+// on many threads, also inside of parallel algorithms. The stored time of a name is the
+// sum over all threads, not the elapsed time. Without store the time is printed right away.
 class ScopeTimer {
 public:
-    explicit ScopeTimer(std::string name, bool store = false)  noexcept : mName(std::move(name)), mStart(std::chrono::steady_clock::now()), mStore(store) { }
+    explicit ScopeTimer(timing::TimerName name, bool store = false) noexcept : mName(name), mStart(timing::Clock::now()), mStore(store) { }
+    // name is a string literal or __func__, see Registry::InternStatic()
+    explicit ScopeTimer(const char* name, bool store = false) : ScopeTimer(timing::TimerName{ timing::Registry::Get().InternStatic(name) }, store) { }
     ~ScopeTimer() {
-        const auto end = std::chrono::steady_clock::now();
-        const auto res = std::chrono::duration <double, std::milli>(end - mStart).count();
+        const auto end = timing::Clock::now();
         if (mStore)
-            sResults[mName] += res;
+            timing::Registry::Get().Record(mName.Id(), mStart, end);
         else
-            std::cout << mName << ": " << res << " ms\n";
+            std::cout << timing::Registry::Get().Name(mName.Id()) << ": " << std::chrono::duration<double, std::milli>(end - mStart).count() << " ms\n";
     }
     ScopeTimer(const ScopeTimer&) = delete;
     ScopeTimer(ScopeTimer&&) = delete;
@@ -25,17 +261,25 @@ public:
     ScopeTimer& operator=(ScopeTimer&&) = delete;
 
     static void ShowStoredResults() {
-        for (const auto&[name, res] : sResults)
-            std::cout << name << ": " << res << " ms\n";
+        const auto toMs = [](double ns) { return ns / 1e6; };
+        for (const auto& [name, stats] : timing::Registry::Get().Merge()) {
+            std::cout << name << ": " << toMs(static_cast<double>(stats.mTotalNs)) << " ms";
+            if (stats.mCount > 1) {
+                std::cout << " (" << stats.mCount << " calls, min " << toMs(static_cast<double>(stats.mMinNs))
+                          << ", p50 " << toMs(stats.PercentileNs(50)) << ", p95 " << toMs(stats.PercentileNs(95))
+                          << ", max " << toMs(static_cast<double>(stats.mMaxNs)) << " ms)";
+            }
+            std::cout << '\n';
+        }
     }
 
+    static void EnableTrace(bool enable = true) noexcept { timing::Registry::Get().EnableTrace(enable); }
+    static void WriteTrace(const std::string& path) { timing::Registry::Get().WriteTrace(path); }
+
 private:
-    const std::string mName;
-    const std::chrono::time_point<std::chrono::steady_clock> mStart;
+    const timing::TimerName mName;
+    const timing::Clock::time_point mStart;
     const bool mStore{ false };
-
-    static inline std::map<std::string, double> sResults;
 };
 
 #endif // SCOPE_TIMER_H
-
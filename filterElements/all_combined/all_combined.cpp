@@ -3,6 +3,7 @@
 #include <execution>
 #include <functional>
 #include <future>
+#include <iomanip>
 #include <iostream>
 #include <memory>
 #include <ranges>
@@ -16,54 +17,9 @@
 
 #include <chrono>
 
-//#include "simpleperf.h"
-
-#include <vector>
-#include <string>
-
-struct Timings {
-	std::string name;
-	double time{};
-	size_t ret{};
-};
-
-#ifdef _MSC_VER
-
-#pragma optimize("", off)
-
-template <class T>
-void DoNotOptimizeAway(T&& datum) {
-	datum = datum;
-}
-
-#pragma optimize("", on)
-
-#elif defined(__clang__)
-
-template <class T>
-__attribute__((__optnone__)) void DoNotOptimizeAway(T&& /* datum */) {}
-
-#else
-
-template <class T>
-void DoNotOptimizeAway(T&& datum) {
-	asm volatile("" : "+r" (datum));
-}
-
-#endif
-
-template <typename TFunc> void RunAndMeasure(const char* title, TFunc func, std::vector<Timings>& timings)
-{
-	const auto start = std::chrono::steady_clock::now();
-	auto ret = func();
-	const auto end = std::chrono::steady_clock::now();
-	DoNotOptimizeAway(ret);
-
-	const auto t = std::chrono::duration <double, std::milli>(end - start).count();
-
-	timings.emplace_back(title, t, ret);
-}
-
+#include "../simpleperf.h"
+#include "../filter_adaptive.h"
+#include "../filter_simd.h"
 
 // filter - copy only those elements into out that satisfies the predicate
 template <typename TContainer>
@@ -348,6 +304,38 @@ auto FilterCopyIfParChunksFutureReserve(const std::vector<T>& vec, Pred p) {
 	return out;
 }
 
+template <typename T, typename Pred>
+auto FilterCopyIfParBlocks(const std::vector<T>& vec, Pred p) {
+	// two passes over blocks: count the matches of every block, a scan over the counts gives
+	// the output offset of every block, then every block copies its matches right into the
+	// exact size output. The extra memory is two values per block, but the predicate runs twice.
+	// The block length comes from PlanFilter, small inputs are filtered sequentially.
+	const auto schedule = PlanFilter(vec, p);
+	if (schedule.threads == 1)
+		return FilterCopyIf(vec, p);
+
+	const size_t blockLen = schedule.chunkLen;
+	const size_t blocks = schedule.chunks;
+
+	std::vector<size_t> indexes(blocks);
+	std::iota(indexes.begin(), indexes.end(), 0);
+	const auto blockBegin = [&vec, blockLen](size_t i) { return std::next(std::begin(vec), i * blockLen); };
+	const auto blockEnd = [&vec, blockLen](size_t i) { return std::next(std::begin(vec), std::min(vec.size(), (i + 1) * blockLen)); };
+
+	std::vector<size_t> offsets(blocks + 1); // offsets[i + 1] is first the count of block i
+	std::for_each(std::execution::par, begin(indexes), end(indexes), [&](size_t i) {
+		offsets[i + 1] = std::count_if(blockBegin(i), blockEnd(i), p);
+	});
+	std::inclusive_scan(begin(offsets), end(offsets), begin(offsets));
+
+	std::vector<T> out(offsets.back());
+	std::for_each(std::execution::par, begin(indexes), end(indexes), [&](size_t i) {
+		std::copy_if(blockBegin(i), blockEnd(i), std::next(std::begin(out), offsets[i]), p);
+	});
+
+	return out;
+}
+
 template <typename T, typename Pred>
 auto FilterCopyIfParTransformPush(const std::vector<T>& vec, Pred p) {
 	std::vector<uint32_t> buffer(vec.size());
@@ -471,7 +459,51 @@ auto MyCopyIf(const std::vector<T>& vec, Pred p)
 	return out;
 }
 
+// Runs some of the filters for the vector sizes 10, 100, ... 10^maxExponent and prints the time
+// of one call in ms, to show from which size on the parallel filters beat the sequential ones.
+// Small sizes are repeated, so that every measurement filters about a million elements.
+template <typename T, typename TGen, typename TTest>
+void SweepSizes(size_t maxExponent, TGen gen, TTest test) {
+	using Filter = std::function<size_t(const std::vector<T>&)>;
+	const std::vector<std::pair<const char*, Filter>> filters{
+		{ "CopyIf", [&test](const std::vector<T>& v) { return FilterCopyIf(v, test).size(); } },
+		{ "ParChunks", [&test](const std::vector<T>& v) { return FilterCopyIfParChunks(v, test).size(); } },
+		{ "ParCompose", [&test](const std::vector<T>& v) { return FilterCopyIfParCompose(v, test).size(); } },
+		{ "ParBlocks", [&test](const std::vector<T>& v) { return FilterCopyIfParBlocks(v, test).size(); } },
+		{ "ParAdaptive", [&test](const std::vector<T>& v) { return FilterCopyIfParAdaptive(v, test).size(); } },
+		{ "Simd", [&test](const std::vector<T>& v) { return FilterSimd(v, test).size(); } },
+	};
+
+	std::cout << std::setw(12) << std::right << "size";
+	for (const auto& [name, filter] : filters)
+		std::cout << std::setw(13) << name;
+	std::cout << '\n';
+
+	std::vector<T> vec;
+	for (size_t size = 10, exponent = 1; exponent <= maxExponent; size *= 10, ++exponent) {
+		const size_t oldSize = vec.size();
+		vec.resize(size);
+		std::generate(std::next(vec.begin(), oldSize), vec.end(), gen);
+
+		const size_t reps = std::max<size_t>(1, 1'000'000 / size);
+		std::cout << std::setw(12) << size << std::fixed << std::setprecision(4);
+		for (const auto& [name, filter] : filters) {
+			size_t ret = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < reps; ++i)
+				ret += filter(vec);
+			const auto end = std::chrono::steady_clock::now();
+			DoNotOptimizeAway(ret);
+
+			std::cout << std::setw(13) << std::chrono::duration<double, std::milli>(end - start).count() / static_cast<double>(reps);
+		}
+		std::cout << std::endl;
+	}
+}
+
 int main(int argc, const char** argv) {
+	bench::Configure(argc, argv);
+
 	const std::vector<std::string> vec{ "Hello", "**txt", "World", "error", "warning", "C++", "****" };
 
 	auto printVec = [](std::string_view intro, const auto& container) {
@@ -511,6 +543,19 @@ int main(int argc, const char** argv) {
 		auto filtered = FilterCopyIfParCompose(vec, [](auto& elem) { return !elem.starts_with('*'); });
 		//printVec("FilterCopyIfParCompose", filtered);
 	}
+	{
+		// strings aren't copied as bytes, so this is std::copy_if
+		auto filtered = FilterSimd(vec, [](auto& elem) { return !elem.starts_with('*'); });
+		//printVec("FilterSimd", filtered);
+	}
+	{
+		auto filtered = FilterCopyIfParAdaptive(vec, [](auto& elem) { return !elem.starts_with('*'); });
+		//printVec("FilterCopyIfParAdaptive", filtered);
+	}
+	{
+		auto filtered = FilterCopyIfParBlocks(vec, [](auto& elem) { return !elem.starts_with('*'); });
+		//printVec("FilterCopyIfParBlocks", filtered);
+	}
 	{
 		auto filtered = FilterRemoveCopyIf(vec, [](auto& elem) { return !elem.starts_with('*'); });
 		//printVec("FilterRemoveCopyIf", filtered);
@@ -558,19 +603,27 @@ int main(int argc, const char** argv) {
 	// benchmark:
 	//std::cout << "\n benchmarks: \n\n";
 
-	const size_t VEC_SIZE = argc > 1 ? atoll(argv[1]) : 10;
-	std::cout << "benchmark vec size: " << VEC_SIZE << '\n';
+	// "--sweep" or "--sweep=maxExponent" measures the vector sizes 10...10^maxExponent (10^8 by default) instead
+	const std::string_view firstArg = argc > 1 ? argv[1] : "";
+	const size_t sweepExponent = firstArg.starts_with("--sweep") ? (firstArg.starts_with("--sweep=") ? atoll(argv[1] + 8) : 8) : 0;
+
+	const size_t VEC_SIZE = sweepExponent == 0 && argc > 1 ? atoll(argv[1]) : 10;
+	if (sweepExponent == 0)
+		std::cout << "benchmark vec size: " << VEC_SIZE << '\n';
 
 #ifdef _DEBUG
 	auto test = [](int elem) { return elem != 0 && elem != 3 && elem != 6; };
+	auto gen = [i = 0]() mutable { return i++; };
 
 	std::vector<int> testVec(VEC_SIZE);
 	std::iota(testVec.begin(), testVec.end(), 0);
 #else
-	std::vector<std::pair<double, double>> testVec(VEC_SIZE);
-	std::ranges::generate(testVec.begin(), testVec.end(), []() mutable {
+	auto gen = []() {
 		return std::pair{ GenRandom(-10.0, 10.0), GenRandom(-10.0, 10.0) };
-		});
+	};
+
+	std::vector<std::pair<double, double>> testVec(VEC_SIZE);
+	std::ranges::generate(testVec.begin(), testVec.end(), gen);
 
 
 	auto test = [](const auto& elem) {
@@ -579,9 +632,14 @@ int main(int argc, const char** argv) {
 	};
 #endif
 
+	if (sweepExponent > 0) {
+		SweepSizes<decltype(gen())>(sweepExponent, gen, test);
+		return 0;
+	}
+
 	std::vector<uint8_t> buffer(testVec.size());
 
-	std::vector<Timings> timings;
+	std::vector<Timing> timings;
 
 	RunAndMeasure("transform only seq          ", [&testVec, &buffer, &test]() {
 		std::transform(begin(testVec), end(testVec), begin(buffer), test);
@@ -618,6 +676,33 @@ int main(int argc, const char** argv) {
 		return filtered.size();
 		}, timings);
 
+	RunAndMeasure("FilterSimd                  ", [&testVec, &test]() {
+		auto filtered = FilterSimd(testVec, test);
+		return filtered.size();
+		}, timings);
+
+	if (BestSimdLevel() == SimdLevel::Avx512) {
+		RunAndMeasure("FilterSimd AVX2             ", [&testVec, &test]() {
+			auto filtered = FilterSimd(testVec, test, SimdLevel::Avx2);
+			return filtered.size();
+			}, timings);
+	}
+
+	RunAndMeasure("FilterSimd scalar           ", [&testVec, &test]() {
+		auto filtered = FilterSimd(testVec, test, SimdLevel::Scalar);
+		return filtered.size();
+		}, timings);
+
+	RunAndMeasure("FilterCopyIfParAdaptive     ", [&testVec, &test]() {
+		auto filtered = FilterCopyIfParAdaptive(testVec, test);
+		return filtered.size();
+		}, timings);
+
+	RunAndMeasure("FilterCopyIfParBlocks       ", [&testVec, &test]() {
+		auto filtered = FilterCopyIfParBlocks(testVec, test);
+		return filtered.size();
+		}, timings);
+
 	RunAndMeasure("FilterCopyIfParChunks       ", [&testVec, &test]() {
 		auto filtered = FilterCopyIfParChunks(testVec, test);
 		return filtered.size();
@@ -699,4 +784,6 @@ int main(int argc, const char** argv) {
 
 	for (const auto& t : timings)
 		std::cout << t.name << ' ' << t.time << '\n';
+
+	bench::DefaultRunner().WriteReports();
 }
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <execution>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+// How a parallel filter splits its input. One thread means the filter runs sequentially.
+struct FilterSchedule {
+	size_t threads{ 1 };
+	size_t chunks{ 1 };
+	size_t chunkLen{ 0 };
+};
+
+namespace filter_schedule {
+
+constexpr size_t SampleLen = 64;              // predicate calls timed to estimate the cost
+constexpr double MinParallelNs = 200'000.0;   // less work than that doesn't pay for waking up the threads
+constexpr double TargetChunkNs = 50'000.0;    // small enough that threads with cheap chunks take over the rest
+constexpr size_t MinChunkLen = 1024;
+constexpr size_t MaxChunksPerThread = 32;     // bounds the per chunk bookkeeping for cheap predicates
+
+constexpr size_t TimedPasses = 3;
+
+// ns per predicate call, measured on elements spread over the whole input. A first pass
+// brings the samples into the cache and binds the functions the predicate calls, then the
+// fastest of the timed passes is taken. The predicate runs SampleLen * (TimedPasses + 1)
+// times more than the filter itself needs, so a predicate with state sees these calls too.
+template <typename T, typename Pred>
+double MeasurePredicateNs(const std::vector<T>& vec, Pred& p) {
+	const size_t samples = std::min(vec.size(), SampleLen);
+	if (samples == 0)
+		return 0.0;
+
+	const size_t stride = vec.size() / samples;
+	size_t hits = 0;
+	for (size_t i = 0; i < samples; ++i)
+		hits += p(vec[i * stride]) ? 1 : 0;
+
+	double bestNs = std::numeric_limits<double>::max();
+	for (size_t pass = 0; pass < TimedPasses; ++pass) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < samples; ++i)
+			hits += p(vec[i * stride]) ? 1 : 0;
+		const auto end = std::chrono::steady_clock::now();
+		bestNs = std::min(bestNs, std::chrono::duration<double, std::nano>(end - start).count());
+	}
+
+	volatile size_t sink = hits; // the calls must not be optimized away
+	(void)sink;
+	return bestNs / static_cast<double>(samples);
+}
+
+} // namespace filter_schedule
+
+// Grain size from the input size and the measured predicate cost: chunks of about
+// TargetChunkNs of work, no more threads than chunks, and sequential when the whole
+// filter is less work than starting the parallel part. Inputs of at least 2 * MinChunkLen
+// elements on a machine with more than one thread call the predicate for the measurement
+// too, see MeasurePredicateNs().
+template <typename T, typename Pred>
+FilterSchedule PlanFilter(const std::vector<T>& vec, Pred& p) {
+	using namespace filter_schedule;
+
+	// hardware_concurrency() might read system files, it's asked once
+	static const size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+	const size_t n = vec.size();
+	if (hardwareThreads == 1 || n < 2 * MinChunkLen) // nothing to split, not even worth measuring
+		return { 1, 1, n };
+
+	const double costNs = std::max(MeasurePredicateNs(vec, p), 0.25);
+	if (costNs * static_cast<double>(n) < MinParallelNs)
+		return { 1, 1, n };
+
+	size_t chunkLen = std::max(MinChunkLen, static_cast<size_t>(TargetChunkNs / costNs));
+	chunkLen = std::max(chunkLen, (n + hardwareThreads * MaxChunksPerThread - 1) / (hardwareThreads * MaxChunksPerThread));
+	const size_t chunks = (n + chunkLen - 1) / chunkLen;
+	return { std::min(hardwareThreads, chunks), chunks, chunkLen };
+}
+
+// Parallel filter with the schedule of PlanFilter. The workers take the next chunk from a
+// shared counter, so a thread that got cheap chunks goes on with the chunks of the others
+// instead of waiting when the predicate cost is skewed over the input. The chunk outputs
+// are then copied in parallel into one output of the exact size.
+template <typename T, typename Pred>
+auto FilterCopyIfParAdaptive(const std::vector<T>& vec, Pred p) {
+	const auto schedule = PlanFilter(vec, p);
+
+	std::vector<T> out;
+	if (schedule.threads == 1) {
+		std::copy_if(begin(vec), end(vec), std::back_inserter(out), p);
+		return out;
+	}
+
+	std::vector<std::vector<T>> parts(schedule.chunks);
+	std::atomic<size_t> nextChunk{ 0 };
+	std::vector<size_t> workers(schedule.threads);
+	std::iota(workers.begin(), workers.end(), 0);
+	std::for_each(std::execution::par, begin(workers), end(workers), [&](size_t) {
+		for (size_t i = nextChunk++; i < schedule.chunks; i = nextChunk++) {
+			const auto startIt = std::next(std::begin(vec), i * schedule.chunkLen);
+			const auto endIt = std::next(std::begin(vec), std::min(vec.size(), (i + 1) * schedule.chunkLen));
+			std::copy_if(startIt, endIt, std::back_inserter(parts[i]), p);
+		}
+	});
+
+	std::vector<size_t> offsets(schedule.chunks + 1);
+	std::transform(begin(parts), end(parts), std::next(begin(offsets)), [](const auto& part) { return part.size(); });
+	std::inclusive_scan(begin(offsets), end(offsets), begin(offsets));
+
+	out.resize(offsets.back());
+	std::vector<size_t> indexes(schedule.chunks);
+	std::iota(indexes.begin(), indexes.end(), 0);
+	std::for_each(std::execution::par, begin(indexes), end(indexes), [&](size_t i) {
+		std::copy(begin(parts[i]), end(parts[i]), std::next(std::begin(out), offsets[i]));
+	});
+
+	return out;
+}
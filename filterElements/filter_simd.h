@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../common/cpu_features.h"
+
+// std::pair has a user provided assignment, so it's never trivially copyable,
+// but a pair of trivially copyable members can still be copied as bytes
+template <typename T>
+struct is_bitwise_copyable : std::is_trivially_copyable<T> {};
+
+template <typename A, typename B>
+struct is_bitwise_copyable<std::pair<A, B>>
+	: std::bool_constant<is_bitwise_copyable<A>::value && is_bitwise_copyable<B>::value> {};
+
+enum class SimdLevel { Scalar, Avx2, Avx512 };
+
+inline const char* ToString(SimdLevel level) {
+	switch (level) {
+	case SimdLevel::Avx2: return "AVX2";
+	case SimdLevel::Avx512: return "AVX-512";
+	default: return "scalar";
+	}
+}
+
+// the widest compress the CPU can run
+inline SimdLevel BestSimdLevel() {
+	if (cpu::HasAvx512f())
+		return SimdLevel::Avx512;
+	if (cpu::HasAvx2())
+		return SimdLevel::Avx2;
+	return SimdLevel::Scalar;
+}
+
+namespace filter_simd {
+
+// elements are tested in batches of 16, bit i of the mask is the predicate of element i
+constexpr size_t BatchLen = 16;
+
+template <typename T, typename Pred>
+uint32_t BatchMask(const T* in, Pred& p) {
+	uint32_t mask = 0;
+	for (size_t i = 0; i < BatchLen; ++i)
+		mask |= static_cast<uint32_t>(static_cast<bool>(p(in[i]))) << i;
+	return mask;
+}
+
+// The rest after the batches: every element is written, but the output position
+// only moves on for the selected ones, so there's no branch to mispredict.
+template <typename T, typename Pred>
+size_t CompressScalar(const T* in, size_t first, size_t n, T* out, size_t count, Pred& p) {
+	for (size_t i = first; i < n; ++i) {
+		out[count] = in[i];
+		count += static_cast<bool>(p(in[i]));
+	}
+	return count;
+}
+
+#ifdef CPU_X86
+// For every mask of the K elements of a 256 bit register: the 32 bit words of the
+// selected elements, moved to the front by _mm256_permutevar8x32_epi32
+template <size_t K>
+constexpr auto MakePermutations() {
+	constexpr size_t words = 8 / K;
+	std::array<std::array<uint32_t, 8>, (size_t{ 1 } << K)> table{};
+	for (size_t mask = 0; mask < table.size(); ++mask) {
+		size_t pos = 0;
+		for (size_t e = 0; e < K; ++e) {
+			if (mask & (size_t{ 1 } << e)) {
+				for (size_t w = 0; w < words; ++w)
+					table[mask][pos++] = static_cast<uint32_t>(e * words + w);
+			}
+		}
+	}
+	return table;
+}
+
+template <size_t K>
+inline constexpr auto Permutations = MakePermutations<K>();
+
+// A register is always stored whole: the selected elements first, then garbage that the
+// next store overwrites. The store never passes the end of the input part it came from,
+// so an output as large as the input is enough.
+template <typename T, typename Pred>
+CPU_TARGET("avx2") size_t CompressAvx2(const T* in, size_t n, T* out, Pred& p) {
+	constexpr size_t K = 32 / sizeof(T); // elements per register
+	const auto& perms = Permutations<K>;
+
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + BatchLen <= n; i += BatchLen) {
+		auto mask = BatchMask(in + i, p);
+		for (size_t r = 0; r < BatchLen; r += K, mask >>= K) {
+			const auto bits = mask & ((1u << K) - 1);
+			const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + r));
+			const auto idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(perms[bits].data()));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count), _mm256_permutevar8x32_epi32(v, idx));
+			count += std::popcount(bits);
+		}
+	}
+	return CompressScalar(in, i, n, out, count, p);
+}
+
+// vpcompressd/q moves the selected lanes to the front, elements wider than
+// 64 bits select all of their lanes
+template <typename T, typename Pred>
+CPU_TARGET("avx512f") size_t CompressAvx512(const T* in, size_t n, T* out, Pred& p) {
+	constexpr size_t K = 64 / sizeof(T); // elements per register
+
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + BatchLen <= n; i += BatchLen) {
+		auto mask = BatchMask(in + i, p);
+		for (size_t r = 0; r < BatchLen; r += K, mask >>= K) {
+			const auto bits = mask & ((1u << K) - 1);
+			const auto v = _mm512_loadu_si512(in + i + r);
+			if constexpr (sizeof(T) == 4) {
+				_mm512_storeu_si512(out + count, _mm512_maskz_compress_epi32(static_cast<__mmask16>(bits), v));
+			}
+			else {
+				uint32_t lanes = 0; // one bit per 64 bit lane
+				for (size_t e = 0; e < K; ++e)
+					lanes |= ((bits >> e) & 1u) * ((1u << (sizeof(T) / 8)) - 1) << (e * (sizeof(T) / 8));
+				_mm512_storeu_si512(out + count, _mm512_maskz_compress_epi64(static_cast<__mmask8>(lanes), v));
+			}
+			count += std::popcount(bits);
+		}
+	}
+	return CompressScalar(in, i, n, out, count, p);
+}
+#endif
+
+} // namespace filter_simd
+
+// Filter for elements of 4, 8 or 16 bytes that can be copied as bytes: the predicate
+// fills a bit mask for a batch of elements (vectorized by the compiler when it can),
+// and the selected elements are compressed into the output a register at a time with
+// AVX2 permutations or AVX-512 compress. Other types, and types without a default
+// constructor, go through std::copy_if.
+template <typename T, typename Pred>
+auto FilterSimd(const std::vector<T>& vec, Pred p, SimdLevel level = BestSimdLevel()) {
+	// the output is sized up front, so T also needs a default constructor
+	constexpr bool simdType = is_bitwise_copyable<T>::value && std::is_trivially_destructible_v<T>
+		&& std::is_default_constructible_v<T> && (sizeof(T) == 4 || sizeof(T) == 8 || sizeof(T) == 16);
+
+	if constexpr (!simdType) {
+		std::vector<T> out;
+		std::copy_if(begin(vec), end(vec), std::back_inserter(out), p);
+		return out;
+	}
+	else {
+		// sized for the worst case and cut afterwards, the stores write whole registers
+		std::vector<T> out(vec.size());
+		size_t count = 0;
+		switch (level) {
+#ifdef CPU_X86
+		case SimdLevel::Avx512: count = filter_simd::CompressAvx512(vec.data(), vec.size(), out.data(), p); break;
+		case SimdLevel::Avx2: count = filter_simd::CompressAvx2(vec.data(), vec.size(), out.data(), p); break;
+#endif
+		default: count = filter_simd::CompressScalar(vec.data(), 0, vec.size(), out.data(), 0, p); break;
+		}
+		out.resize(count);
+		return out;
+	}
+}
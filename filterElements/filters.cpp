@@ -12,6 +12,8 @@
 #include <type_traits>
 
 #include "simpleperf.h"
+#include "filter_adaptive.h"
+#include "filter_simd.h"
 
 // filter - copy only those elements into out that satisfies the predicate
 template <typename TContainer>
@@ -291,6 +293,38 @@ auto FilterCopyIfParChunksFutureReserve(const std::vector<T>& vec, Pred p) {
 	return out;
 }
 
+template <typename T, typename Pred>
+auto FilterCopyIfParBlocks(const std::vector<T>& vec, Pred p) {
+	// two passes over blocks: count the matches of every block, a scan over the counts gives
+	// the output offset of every block, then every block copies its matches right into the
+	// exact size output. The extra memory is two values per block, but the predicate runs twice.
+	// The block length comes from PlanFilter, small inputs are filtered sequentially.
+	const auto schedule = PlanFilter(vec, p);
+	if (schedule.threads == 1)
+		return FilterCopyIf(vec, p);
+
+	const size_t blockLen = schedule.chunkLen;
+	const size_t blocks = schedule.chunks;
+
+	std::vector<size_t> indexes(blocks);
+	std::iota(indexes.begin(), indexes.end(), 0);
+	const auto blockBegin = [&vec, blockLen](size_t i) { return std::next(std::begin(vec), i * blockLen); };
+	const auto blockEnd = [&vec, blockLen](size_t i) { return std::next(std::begin(vec), std::min(vec.size(), (i + 1) * blockLen)); };
+
+	std::vector<size_t> offsets(blocks + 1); // offsets[i + 1] is first the count of block i
+	std::for_each(std::execution::par, begin(indexes), end(indexes), [&](size_t i) {
+		offsets[i + 1] = std::count_if(blockBegin(i), blockEnd(i), p);
+	});
+	std::inclusive_scan(begin(offsets), end(offsets), begin(offsets));
+
+	std::vector<T> out(offsets.back());
+	std::for_each(std::execution::par, begin(indexes), end(indexes), [&](size_t i) {
+		std::copy_if(blockBegin(i), blockEnd(i), std::next(std::begin(out), offsets[i]), p);
+	});
+
+	return out;
+}
+
 template <typename T, typename Pred>
 auto FilterCopyIfParTransformPush(const std::vector<T>& vec, Pred p) {
 	std::vector<uint32_t> buffer(vec.size());
@@ -357,6 +391,8 @@ auto FilterRangesCopyIfGen(const TCont& vec, Pred p) {
 }
 
 int main(int argc, const char** argv) {
+	bench::Configure(argc, argv);
+
 	const std::vector<std::string> vec{ "Hello", "**txt", "World", "error", "warning", "C++", "****" };
 
 	auto printVec = [](std::string_view intro, const auto& container) {
@@ -390,6 +426,19 @@ int main(int argc, const char** argv) {
 		auto filtered = FilterCopyIfParNaive(vec, [](auto& elem) { return !elem.starts_with('*'); });
 		printVec("FilterCopyIfPar", filtered);
 	}
+	{
+		// strings aren't copied as bytes, so this is std::copy_if
+		auto filtered = FilterSimd(vec, [](auto& elem) { return !elem.starts_with('*'); });
+		printVec("FilterSimd", filtered);
+	}
+	{
+		auto filtered = FilterCopyIfParAdaptive(vec, [](auto& elem) { return !elem.starts_with('*'); });
+		printVec("FilterCopyIfParAdaptive", filtered);
+	}
+	{
+		auto filtered = FilterCopyIfParBlocks(vec, [](auto& elem) { return !elem.starts_with('*'); });
+		printVec("FilterCopyIfParBlocks", filtered);
+	}
 	{
 		auto filtered = FilterRemoveCopyIf(vec, [](auto& elem) { return !elem.starts_with('*'); });
 		printVec("FilterRemoveCopyIf", filtered);
@@ -496,6 +545,33 @@ int main(int argc, const char** argv) {
 		return filtered.size();
 	}, timings);
 
+	RunAndMeasure("FilterSimd                  ", [&testVec, &test]() {
+		auto filtered = FilterSimd(testVec, test);
+		return filtered.size();
+	}, timings);
+
+	if (BestSimdLevel() == SimdLevel::Avx512) {
+		RunAndMeasure("FilterSimd AVX2             ", [&testVec, &test]() {
+			auto filtered = FilterSimd(testVec, test, SimdLevel::Avx2);
+			return filtered.size();
+		}, timings);
+	}
+
+	RunAndMeasure("FilterSimd scalar           ", [&testVec, &test]() {
+		auto filtered = FilterSimd(testVec, test, SimdLevel::Scalar);
+		return filtered.size();
+	}, timings);
+
+	RunAndMeasure("FilterCopyIfParAdaptive     ", [&testVec, &test]() {
+		auto filtered = FilterCopyIfParAdaptive(testVec, test);
+		return filtered.size();
+	}, timings);
+
+	RunAndMeasure("FilterCopyIfParBlocks       ", [&testVec, &test]() {
+		auto filtered = FilterCopyIfParBlocks(testVec, test);
+		return filtered.size();
+	}, timings);
+
 	RunAndMeasure("FilterCopyIfParChunks       ", [&testVec, &test]() {
 		auto filtered = FilterCopyIfParChunks(testVec, test);
 		return filtered.size();
@@ -520,4 +596,6 @@ int main(int argc, const char** argv) {
 
 	for (const auto& t : timings)
 		std::cout << t.name << ' ' << t.time << '\n';
+
+	bench::DefaultRunner().WriteReports();
 }
\ No newline at end of file
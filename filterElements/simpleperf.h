@@ -1,62 +1,21 @@
 #pragma once
 
-#include <chrono>
-
-// from https://stackoverflow.com/questions/33975479/escape-and-clobber-equivalent-in-msvc
-/**
- * Call doNotOptimizeAway(var) against variables that you use for
- * benchmarking but otherwise are useless. The compiler tends to do a
- * good job at eliminating unused variables, and this function fools
- * it into thinking var is in fact needed.
- */
-#ifdef _MSC_VER
-
-#pragma optimize("", off)
-
-template <class T>
-void DoNotOptimizeAway(T&& datum) {
-	datum = datum;
-}
-
-#pragma optimize("", on)
-
-#elif defined(__clang__)
-
-template <class T>
-__attribute__((__optnone__)) void DoNotOptimizeAway(T&& /* datum */) {}
-
-#else
-
-template <class T>
-void DoNotOptimizeAway(T&& datum) {
-	asm volatile("" : "+r" (datum));
-}
-
-#endif
+#include "../common/benchmark.h"
 
+// forwards to the shared harness, see common/benchmark.h
 template <typename TFunc> void RunAndMeasure(const char* title, TFunc func)
 {
-	const auto start = std::chrono::steady_clock::now();
-	auto ret = func();
-	const auto end = std::chrono::steady_clock::now();
-	DoNotOptimizeAway(ret);
-	std::cout << title << ": " << std::chrono::duration <double, std::milli>(end - start).count() << " ms, ret: " << ret << '\n';
+	bench::DefaultRunner().Run(title, func);
 }
 
 struct Timing {
 	std::string name;
-	double time{};
-	size_t ret{};
+	double time{}; // median
+	std::string ret;
 };
 
 template <typename TFunc> void RunAndMeasure(const char* title, TFunc func, std::vector<Timing>& timings)
 {
-	const auto start = std::chrono::steady_clock::now();
-	auto ret = func();
-	const auto end = std::chrono::steady_clock::now();
-	DoNotOptimizeAway(ret);
-
-	const auto t = std::chrono::duration <double, std::milli>(end - start).count();
-
-	timings.emplace_back(title, t, ret);
+	const auto& result = bench::DefaultRunner().Run(title, func);
+	timings.push_back({ result.name, result.medianMs, result.ret });
 }
@@ -1,45 +1,44 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
 
-// from https://stackoverflow.com/questions/33975479/escape-and-clobber-equivalent-in-msvc
-/**
- * Call doNotOptimizeAway(var) against variables that you use for
- * benchmarking but otherwise are useless. The compiler tends to do a
- * good job at eliminating unused variables, and this function fools
- * it into thinking var is in fact needed.
- */
-#ifdef _MSC_VER
-
-#pragma optimize("", off)
+#include "../../common/benchmark.h"
 
-template <class T>
-void DoNotOptimizeAway(T&& datum) {
-	datum = datum;
+// forwards to the shared harness, see common/benchmark.h
+template <typename TFunc> void RunAndMeasure(const char* title, TFunc func)
+{
+	bench::DefaultRunner().Run(title, func);
 }
 
-#pragma optimize("", on)
-
-#elif defined(__clang__)
-
-template <class T>
-__attribute__((__optnone__)) void DoNotOptimizeAway(T&& /* datum */) {}
-
-#else
-
-template <class T>
-void DoNotOptimizeAway(T&& datum) {
-	asm volatile("" : "+r" (datum));
+// setup resets the state changed by func, it runs before every repetition and is not measured
+template <typename TFunc, typename TSetup> void RunAndMeasure(const char* title, TFunc func, TSetup setup)
+{
+	bench::DefaultRunner().Run(title, func, setup);
 }
 
+// resident set size of the current process, 0 if not available
+inline size_t CurrentRssBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.WorkingSetSize;
+	return 0;
+#else
+	std::ifstream statm{ "/proc/self/statm" };
+	size_t totalPages = 0, residentPages = 0;
+	if (statm >> totalPages >> residentPages)
+		return residentPages * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+	return 0;
 #endif
-
-template <typename TFunc> void RunAndMeasure(const char* title, TFunc func)
-{
-	const auto start = std::chrono::steady_clock::now();
-	auto ret = func();
-	const auto end = std::chrono::steady_clock::now();
-	DoNotOptimizeAway(ret);
-	std::cout << title << ": " << std::chrono::duration <double, std::milli>(end - start).count() << " ms, ret: " << ret << '\n';
 }
-
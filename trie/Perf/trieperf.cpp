@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <atomic>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -8,11 +10,18 @@
 #include <sstream>
 #include <stack>
 #include <set>
+#include <shared_mutex>
 #include <string_view>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector> 
 
 #include "../trie.h"
+#include "../flat_trie.h"
+#include "../radix_trie.h"
+#include "../frozen_trie.h"
+#include "../concurrent_trie.h"
 #include "simpleperf.h"
 
 using namespace std::literals;
@@ -23,6 +32,8 @@ const std::string_view LoremIpsumStrv{ "Lorem ipsum dolor sit amet, consectetur
 "irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur. "
 "Excepteur sint occaecat cupidatatsuperlongword non proident, sunt in culpa qui officia deserunt mollit anim id est laborum." };
 
+constexpr size_t TopCount = 10;
+
 std::vector<std::string_view>
 splitSVStd(std::string_view strv, std::string_view delims = " ")
 {
@@ -50,11 +61,50 @@ splitSVStd(std::string_view strv, std::string_view delims = " ")
 }
 
 
+size_t LevenshteinDistance(std::string_view a, std::string_view b) {
+	std::vector<size_t> prev(b.size() + 1), row(b.size() + 1);
+	std::iota(prev.begin(), prev.end(), 0);
+	for (size_t i = 1; i <= a.size(); ++i) {
+		row[0] = i;
+		for (size_t j = 1; j <= b.size(); ++j)
+			row[j] = std::min({ prev[j] + 1, row[j - 1] + 1, prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1) });
+		std::swap(prev, row);
+	}
+	return prev[b.size()];
+}
+
+// runs lookups over all words on every thread, returns millions of lookups per second
+template <typename TFind>
+double MeasureLookupThroughput(size_t numThreads, const std::vector<std::string>& words, TFind find) {
+	std::atomic<size_t> found{ 0 };
+	const auto start = std::chrono::steady_clock::now();
+	{
+		std::vector<std::jthread> threads;
+		for (size_t t = 0; t < numThreads; ++t) {
+			threads.emplace_back([&words, &find, &found, t]() {
+				size_t cnt = 0;
+				// different starting points, so the threads don't walk the same nodes in lockstep
+				for (size_t i = 0; i < words.size(); ++i)
+					cnt += find(words[(i + t * 7919) % words.size()]) ? 1 : 0;
+				found += cnt;
+			});
+		}
+	}
+	const auto end = std::chrono::steady_clock::now();
+	auto totalFound = found.load();
+	DoNotOptimizeAway(totalFound);
+
+	const auto lookups = static_cast<double>(numThreads * words.size());
+	return lookups / std::chrono::duration<double, std::micro>(end - start).count();
+}
+
 int main(int argc, const char** argv) {
+	bench::Configure(argc, argv);
+
 	std::string testString{ LoremIpsumStrv };
 
 	if (argc == 1)
-		std::cout << "trie-perf.exe filename iterations\nNow using default params...\n\n";
+		std::cout << "trie-perf.exe filename iterations maxThreads [--bench-runs=N --bench-counters --bench-csv=file ...]\nNow using default params...\n\n";
 
 	if (argc > 1 && "nofile"s != argv[1]) {
 		std::ifstream inFile(argv[1]);
@@ -75,19 +125,83 @@ int main(int argc, const char** argv) {
 
 	std::set<std::string> setWords;
 	Trie trieWords;
+	FlatTrie flatTrieWords;
+	RadixTrie radixTrieWords;
 
 	RunAndMeasure("set insert words", [&setWords, &extractedWords]() {
 		for (auto& word : extractedWords)
 			setWords.insert({ word.data(), word.length() });
 		return 0;
-	});
+	}, [&setWords]() { setWords.clear(); });
 
 	RunAndMeasure("trie insert words", [&trieWords, &extractedWords]() {
 		for (auto& word : extractedWords)
 			trieWords.Insert(word);
 		return 0;
+	}, [&trieWords]() { trieWords = Trie{}; });
+
+	RunAndMeasure("flat trie insert words", [&flatTrieWords, &extractedWords]() {
+		for (auto& word : extractedWords)
+			flatTrieWords.Insert(word);
+		return 0;
+	}, [&flatTrieWords]() { flatTrieWords = FlatTrie{}; });
+
+	RunAndMeasure("radix trie insert words", [&radixTrieWords, &extractedWords]() {
+		for (auto& word : extractedWords)
+			radixTrieWords.Insert(word);
+		return 0;
+	}, [&radixTrieWords]() { radixTrieWords = RadixTrie{}; });
+
+	{
+		Trie bulkTrie;
+		RunAndMeasure("trie bulk build", [&bulkTrie, &extractedWords]() {
+			bulkTrie = Trie::BulkBuild(extractedWords);
+			return bulkTrie.NumNodes();
+		}, [&bulkTrie]() { bulkTrie = Trie{}; });
+
+		auto sortedWords = extractedWords;
+		std::ranges::sort(sortedWords);
+		RunAndMeasure("trie bulk build, presorted", [&bulkTrie, &sortedWords]() {
+			bulkTrie = Trie::BulkBuild(sortedWords);
+			return bulkTrie.NumNodes();
+		}, [&bulkTrie]() { bulkTrie = Trie{}; });
+
+		FlatTrie bulkFlatTrie;
+		RunAndMeasure("flat trie bulk build, presorted", [&bulkFlatTrie, &sortedWords]() {
+			bulkFlatTrie = FlatTrie::BulkBuild(sortedWords);
+			return bulkFlatTrie.NumNodes();
+		}, [&bulkFlatTrie]() { bulkFlatTrie = FlatTrie{}; });
+	}
+
+	std::cout << "trie:       nodes: " << trieWords.NumNodes() << ", bytes: " << trieWords.BytesUsed() << '\n';
+	std::cout << "flat trie:  nodes: " << flatTrieWords.NumNodes() << ", bytes: " << flatTrieWords.BytesUsed() << '\n';
+	std::cout << "radix trie: nodes: " << radixTrieWords.NumNodes() << ", bytes: " << radixTrieWords.BytesUsed() << '\n';
+
+	// cold start: rebuilding the trie from text vs mapping a frozen image
+	const auto imagePath = std::filesystem::temp_directory_path() / "trieperf.trieimg";
+	RunAndMeasure("trie freeze to file", [&trieWords, &imagePath]() {
+		trieWords.Freeze(imagePath);
+		return std::filesystem::file_size(imagePath);
 	});
 
+	Trie coldTrie;
+	const auto rssBefore = CurrentRssBytes();
+	RunAndMeasure("cold start, trie from text", [&coldTrie, &testString]() {
+		for (auto& word : splitSVStd(testString, " ,.\n"))
+			coldTrie.Insert(word);
+		return coldTrie.Size();
+	}, [&coldTrie]() { coldTrie = Trie{}; });
+	const auto rssAfter = CurrentRssBytes();
+	std::cout << "    RSS growth: " << (rssAfter > rssBefore ? (rssAfter - rssBefore) / 1024 : 0) << " KB\n";
+
+	// no RSS here: the image is still in the page cache after the freeze, and of the mapping
+	// only the node pages read by the load checks become resident
+	FrozenTrie frozenTrie;
+	RunAndMeasure("cold start, frozen trie mmap (page cache warm)", [&frozenTrie, &imagePath]() {
+		frozenTrie = FrozenTrie::Load(imagePath);
+		return frozenTrie.Size();
+	}, [&frozenTrie]() { frozenTrie = FrozenTrie{}; });
+
 	std::uniform_int_distribution<size_t> distr{ 0, extractedWords.size()-1 };
 	std::random_device engine;
 	std::mt19937 noise{ engine() };
@@ -118,6 +232,36 @@ int main(int argc, const char** argv) {
 		return cnt;
 	});
 
+	RunAndMeasure("flat trie search ITER random words", [&flatTrieWords, &wordsToSearch]() {
+		size_t cnt = 0;
+		for (auto& word : wordsToSearch)
+		{
+			if (flatTrieWords.Find(word))
+				++cnt;
+		}
+		return cnt;
+	});
+
+	RunAndMeasure("frozen trie search ITER random words", [&frozenTrie, &wordsToSearch]() {
+		size_t cnt = 0;
+		for (auto& word : wordsToSearch)
+		{
+			if (frozenTrie.Find(word))
+				++cnt;
+		}
+		return cnt;
+	});
+
+	RunAndMeasure("radix trie search ITER random words", [&radixTrieWords, &wordsToSearch]() {
+		size_t cnt = 0;
+		for (auto& word : wordsToSearch)
+		{
+			if (radixTrieWords.Find(word))
+				++cnt;
+		}
+		return cnt;
+	});
+
 	std::vector<std::string> prefixWords(ITERS);
 	std::transform(wordsToSearch.begin(), wordsToSearch.end(), prefixWords.begin(), [](const std::string& word) {
 		if (word.length() > 4) {
@@ -155,4 +299,144 @@ int main(int argc, const char** argv) {
 		}
 		return cnt;
 		});
+
+	RunAndMeasure("trie prefix search, streamed", [&trieWords, &prefixWords]() {
+		size_t cnt = 0;
+		for (auto& prefix : prefixWords)
+			cnt += trieWords.ForEachMatch(prefix, [](std::string_view) {});
+		return cnt;
+		});
+
+	RunAndMeasure("trie prefix search, streamed, first 10", [&trieWords, &prefixWords]() {
+		size_t cnt = 0;
+		for (auto& prefix : prefixWords)
+			cnt += trieWords.ForEachMatch(prefix, [](std::string_view) {}, 10);
+		return cnt;
+		});
+
+	RunAndMeasure("flat trie prefix search", [&flatTrieWords, &prefixWords]() {
+		size_t cnt = 0;
+		for (auto& prefix : prefixWords)
+			cnt += flatTrieWords.Match(prefix).size();
+		return cnt;
+		});
+
+	RunAndMeasure("frozen trie prefix search, streamed", [&frozenTrie, &prefixWords]() {
+		size_t cnt = 0;
+		for (auto& prefix : prefixWords)
+			cnt += frozenTrie.ForEachMatch(prefix, [](std::string_view) {});
+		return cnt;
+		});
+
+	RunAndMeasure("radix trie prefix search", [&radixTrieWords, &prefixWords]() {
+		size_t cnt = 0;
+		for (auto& prefix : prefixWords)
+			cnt += radixTrieWords.Match(prefix).size();
+		return cnt;
+		});
+
+	// ranked autocomplete, word frequencies in the text are the weights
+	std::unordered_map<std::string_view, uint32_t> frequencies;
+	RunAndMeasure("unordered_map count words", [&frequencies, &extractedWords]() {
+		for (auto& word : extractedWords)
+			++frequencies[word];
+		return frequencies.size();
+		}, [&frequencies]() { frequencies = {}; });
+
+	TrieMap<uint32_t> frequencyTrie;
+	RunAndMeasure("trie map count words", [&frequencyTrie, &extractedWords]() {
+		for (auto& word : extractedWords)
+			++frequencyTrie[word];
+		return frequencyTrie.Size();
+		}, [&frequencyTrie]() { frequencyTrie = TrieMap<uint32_t>{}; });
+
+	Trie weightedTrie;
+	for (auto& [word, freq] : frequencies)
+		weightedTrie.Insert(word, freq);
+
+	RunAndMeasure("trie match + partial_sort top 10", [&weightedTrie, &frequencies, &prefixWords]() {
+		size_t cnt = 0;
+		for (auto& prefix : prefixWords) {
+			auto words = weightedTrie.Match(prefix);
+			const auto topEnd = words.begin() + std::min(TopCount, words.size());
+			std::partial_sort(words.begin(), topEnd, words.end(), [&frequencies](const std::string& a, const std::string& b) {
+				return frequencies.find(a)->second > frequencies.find(b)->second;
+			});
+			cnt += std::distance(words.begin(), topEnd);
+		}
+		return cnt;
+		});
+
+	RunAndMeasure("trie TopK 10", [&weightedTrie, &prefixWords]() {
+		size_t cnt = 0;
+		for (auto& prefix : prefixWords)
+			cnt += weightedTrie.TopK(prefix, TopCount).size();
+		return cnt;
+		});
+
+	// fuzzy search for misspelled words: brute force scan vs trie walk with pruning
+	constexpr size_t MaxEdits = 2;
+	std::vector<std::string> typoWords(std::min<size_t>(ITERS, 100));
+	std::transform(wordsToSearch.begin(), wordsToSearch.begin() + typoWords.size(), typoWords.begin(), [&noise](std::string word) {
+		word[noise() % word.size()] = 'a' + noise() % 26;
+		return word;
+	});
+
+	RunAndMeasure("set fuzzy search, brute force", [&setWords, &typoWords]() {
+		size_t cnt = 0;
+		for (auto& typo : typoWords) {
+			for (auto& word : setWords) {
+				if (LevenshteinDistance(typo, word) <= MaxEdits)
+					++cnt;
+			}
+		}
+		return cnt;
+		});
+
+	RunAndMeasure("trie fuzzy search", [&trieWords, &typoWords]() {
+		size_t cnt = 0;
+		for (auto& typo : typoWords)
+			cnt += trieWords.FuzzyMatch(typo, MaxEdits).size();
+		return cnt;
+		});
+
+	// multi threaded lookups: a std::map based Trie behind a reader/writer lock vs ConcurrentTrie
+	const size_t maxThreads = argc > 3 ? atoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+
+	std::shared_mutex trieMutex;
+	ConcurrentTrie concurrentTrie;
+	for (auto& word : extractedWords)
+		concurrentTrie.Insert(word);
+
+	std::cout << "lookup throughput (M lookups/s), threads: trie + shared_mutex | concurrent trie | concurrent trie + writer\n";
+	for (size_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+		const auto locked = MeasureLookupThroughput(numThreads, wordsToSearch, [&trieWords, &trieMutex](const std::string& word) {
+			std::shared_lock lock(trieMutex);
+			return trieWords.Find(word);
+		});
+
+		const auto concurrent = MeasureLookupThroughput(numThreads, wordsToSearch, [&concurrentTrie](const std::string& word) {
+			return concurrentTrie.Find(word);
+		});
+
+		std::atomic<bool> stopWriter{ false };
+		std::jthread writer([&concurrentTrie, &extractedWords, &stopWriter]() {
+			for (size_t i = 0; !stopWriter; i = (i + 1) % extractedWords.size()) {
+				const std::string word{ std::string{ extractedWords[i] } + "_w" };
+				concurrentTrie.Insert(word);
+				concurrentTrie.RemoveAndDeleteNodes(word);
+			}
+		});
+		const auto withWriter = MeasureLookupThroughput(numThreads, wordsToSearch, [&concurrentTrie](const std::string& word) {
+			return concurrentTrie.Find(word);
+		});
+		stopWriter = true;
+
+		std::cout << "    " << numThreads << ": " << locked << " | " << concurrent << " | " << withWriter << '\n';
+	}
+
+	frozenTrie = FrozenTrie{};
+	std::filesystem::remove(imagePath);
+
+	bench::DefaultRunner().WriteReports();
 }
\ No newline at end of file
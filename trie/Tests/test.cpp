@@ -1,5 +1,11 @@
 #include "gtest/gtest.h"
 #include "../trie.h"
+#include "../flat_trie.h"
+#include "../radix_trie.h"
+#include "../frozen_trie.h"
+#include "../concurrent_trie.h"
+
+#include <thread>
 
 TEST(Creation, Basic) {
 	Trie tr;
@@ -72,6 +78,65 @@ TEST(Remove, ThreeWordsFull) {
 	EXPECT_EQ(tr.NumNodes(), 4); // ABDD was left
 }
 
+TEST(Remove, PrefixWordFull) {
+	Trie tr{ "hell", "hello", "help" };
+	EXPECT_EQ(tr.NumNodes(), 6);
+	EXPECT_TRUE(tr.RemoveAndDeleteNodes("hell")); // "hello" goes on through it
+	EXPECT_EQ(tr.Size(), 2);
+	EXPECT_EQ(tr.NumNodes(), 6);
+	EXPECT_TRUE(tr.Find("hello"));
+	EXPECT_FALSE(tr.Find("hell"));
+
+	EXPECT_TRUE(tr.RemoveAndDeleteNodes("hello")); // only "lo" belonged to it
+	EXPECT_EQ(tr.Size(), 1);
+	EXPECT_EQ(tr.NumNodes(), 4);
+	EXPECT_TRUE(tr.Find("help"));
+}
+
+TEST(Remove, WordBelowWordFull) {
+	TrieMap<int> tm;
+	tm["ab"] = 1;
+	tm["abcd"] = 2;
+	EXPECT_TRUE(tm.RemoveAndDeleteNodes("abcd")); // stops at "ab", which is a word
+	EXPECT_EQ(tm.Size(), 1);
+	EXPECT_EQ(tm.NumNodes(), 2);
+	ASSERT_NE(tm.find("ab"), nullptr);
+	EXPECT_EQ(*tm.find("ab"), 1);
+}
+
+TEST(BulkBuild, SameAsInsert) {
+	const std::vector<std::string> words{ "XYZ", "ABDD", "ABC", "", "ABC", "AB", "\xF0\x9F" };
+	Trie inserted;
+	for (auto& w : words)
+		inserted.Insert(w);
+
+	const auto built = Trie::BulkBuild(words);
+	EXPECT_EQ(built.Size(), inserted.Size());
+	EXPECT_EQ(built.NumNodes(), inserted.NumNodes());
+	EXPECT_EQ(built.Match(""), inserted.Match(""));
+
+	const auto flat = FlatTrie::BulkBuild(words);
+	EXPECT_EQ(flat.Size(), inserted.Size());
+	EXPECT_EQ(flat.NumNodes(), inserted.NumNodes());
+	EXPECT_TRUE(flat.Find("AB"));
+	EXPECT_FALSE(flat.Find("ABD"));
+}
+
+TEST(BulkBuild, SameAsInsertParallel) {
+	// enough words for the parallel build, with bytes above 0x7F inside the words
+	std::vector<std::string> words;
+	for (int i = 0; i < 6000; ++i)
+		words.push_back({ static_cast<char>('a' + i % 7), static_cast<char>(0x60 + i % 64 * 3), static_cast<char>(i * 37 % 256 | 1) });
+	Trie inserted;
+	for (auto& w : words)
+		inserted.Insert(w);
+
+	const auto built = Trie::BulkBuild(words);
+	EXPECT_EQ(built.Size(), inserted.Size());
+	EXPECT_EQ(built.NumNodes(), inserted.NumNodes());
+	EXPECT_EQ(built.Match(""), inserted.Match(""));
+}
+
 TEST(Match, Empty) {
 	Trie tr;
 	auto vec = tr.Match("");
@@ -88,4 +153,264 @@ TEST(Match, FewWords) {
 	Trie tr{ "ABC", "ABCD", "ABCDE", "ABXYZ" };
 	auto vec = tr.Match("ABC");
 	EXPECT_EQ(vec.size(), 3);
+}
+
+TEST(Match, Sorted) {
+	Trie tr{ "ABXYZ", "ABCDE", "ABC", "ABCD" };
+	const std::vector<std::string> expected{ "ABC", "ABCD", "ABCDE", "ABXYZ" };
+	EXPECT_EQ(tr.Match("AB"), expected);
+}
+
+TEST(ForEachMatch, Limit) {
+	Trie tr{ "ABC", "ABCD", "ABCDE", "ABXYZ" };
+	std::vector<std::string> words;
+	const auto cnt = tr.ForEachMatch("AB", [&words](std::string_view w) { words.emplace_back(w); }, 2);
+	EXPECT_EQ(cnt, 2);
+	const std::vector<std::string> expected{ "ABC", "ABCD" };
+	EXPECT_EQ(words, expected);
+}
+
+TEST(ForEachMatch, EarlyStop) {
+	Trie tr{ "ABC", "ABCD", "ABCDE", "ABXYZ" };
+	const auto cnt = tr.ForEachMatch("", [](std::string_view w) { return w != "ABCDE"; });
+	EXPECT_EQ(cnt, 3);
+	EXPECT_EQ(tr.ForEachMatch("X", [](std::string_view) {}), 0);
+}
+
+TEST(FuzzyMatch, Distances) {
+	Trie tr{ "hello", "help", "hell", "world", "word" };
+	const auto res = tr.FuzzyMatch("helo", 1);
+	ASSERT_EQ(res.size(), 3);
+	EXPECT_EQ(res[0].distance, 1);
+	EXPECT_EQ(res[0].word, "hell");
+	EXPECT_EQ(res[1].word, "hello");
+	EXPECT_EQ(res[2].word, "help");
+
+	EXPECT_EQ(tr.FuzzyMatch("word", 0).size(), 1);
+	EXPECT_EQ(tr.FuzzyMatch("wrld", 1).front().word, "world");
+	EXPECT_TRUE(tr.FuzzyMatch("xyz", 2).empty());
+}
+
+TEST(TopK, Weights) {
+	Trie tr;
+	tr.Insert("car", 10);
+	tr.Insert("cart", 50);
+	tr.Insert("carbon", 20);
+	tr.Insert("cat", 40);
+	tr.Insert("dog", 100);
+
+	const auto top = tr.TopK("ca", 2);
+	ASSERT_EQ(top.size(), 2);
+	EXPECT_EQ(top[0].word, "cart");
+	EXPECT_EQ(top[0].weight, 50);
+	EXPECT_EQ(top[1].word, "cat");
+	EXPECT_EQ(tr.TopK("", 1).front().word, "dog");
+	EXPECT_EQ(tr.TopK("car", 10).size(), 3);
+	EXPECT_TRUE(tr.TopK("x", 10).empty());
+}
+
+TEST(TopK, UpdateAndRemove) {
+	Trie tr;
+	tr.Insert("cart", 50);
+	tr.Insert("cat", 40);
+	tr.Insert("cart", 5);
+	EXPECT_EQ(tr.TopK("ca", 1).front().word, "cat");
+	tr.Remove("cat");
+	EXPECT_EQ(tr.TopK("ca", 1).front().word, "cart");
+	tr.Insert("cab", 7);
+	tr.RemoveAndDeleteNodes("cab");
+	EXPECT_EQ(tr.TopK("", 5).size(), 1);
+	EXPECT_EQ(tr.TopK("", 5).front().weight, 5);
+}
+
+TEST(TrieMap, Values) {
+	TrieMap<int> tm;
+	tm["abc"] = 1;
+	++tm["abc"];
+	EXPECT_EQ(tm["abc"], 2);
+	EXPECT_FALSE(tm.try_emplace("abc", 10).second);
+	EXPECT_TRUE(tm.try_emplace("ab", 10).second);
+	EXPECT_EQ(tm.Size(), 2);
+
+	const std::string key{ "ab" };
+	ASSERT_NE(tm.find(key), nullptr);
+	EXPECT_EQ(*tm.find(key), 10);
+	EXPECT_EQ(tm.find("a"), nullptr);
+
+	int sum = 0;
+	tm.ForEachMatch("a", [&sum](std::string_view, int value) { sum += value; });
+	EXPECT_EQ(sum, 12);
+
+	EXPECT_TRUE(tm.Remove("ab"));
+	EXPECT_EQ(tm.find("ab"), nullptr);
+	EXPECT_EQ(tm["ab"], 0);
+}
+
+TEST(TrieMap, WideChars) {
+	TrieMap<std::string, char16_t> utf16;
+	utf16[u"żółw"] = "turtle";
+	utf16[u"żuk"] = "beetle";
+	EXPECT_EQ(utf16.Match(u"ż").size(), 2);
+	EXPECT_EQ(*utf16.find(u"żuk"), "beetle");
+
+	TrieMap<void, char32_t> utf32{ U"\U0001F600", U"\U0001F601", U"a" };
+	EXPECT_EQ(utf32.NumNodes(), 3);
+	EXPECT_TRUE(utf32.Find(U"\U0001F601"));
+	EXPECT_EQ(utf32.FuzzyMatch(U"\U0001F602", 1).size(), 3);
+}
+
+TEST(FlatTrie, Insert) {
+	FlatTrie tr{ "XYZ", "ABC", "ABDD" };
+	EXPECT_EQ(tr.Size(), 3);
+	EXPECT_EQ(tr.NumNodes(), 8);
+	tr.Insert("ABC");
+	EXPECT_EQ(tr.Size(), 3);
+	EXPECT_TRUE(tr.Find("ABDD"));
+	EXPECT_FALSE(tr.Find("ABD"));
+}
+
+TEST(FlatTrie, DenseNode) {
+	FlatTrie tr;
+	for (int ch = 0; ch < 256; ++ch)
+		tr.Insert(std::string{ 'A', static_cast<char>(ch) });
+	EXPECT_EQ(tr.Size(), 256);
+	EXPECT_EQ(tr.NumNodes(), 257);
+	EXPECT_TRUE(tr.Find("AZ"));
+	EXPECT_EQ(tr.Match("A").size(), 256);
+}
+
+TEST(FlatTrie, RemoveAndDeleteNodes) {
+	FlatTrie tr{ "XYZ", "ABC", "ABDD" };
+	tr.RemoveAndDeleteNodes("XYZ");
+	tr.RemoveAndDeleteNodes("ABC");
+	EXPECT_EQ(tr.Size(), 1);
+	EXPECT_EQ(tr.NumNodes(), 4);
+	tr.Insert("ABCD");
+	EXPECT_EQ(tr.NumNodes(), 6);
+}
+
+TEST(FlatTrie, MatchSorted) {
+	FlatTrie tr{ "ABXYZ", "ABCDE", "ABC", "ABCD" };
+	const std::vector<std::string> expected{ "ABC", "ABCD", "ABCDE" };
+	EXPECT_EQ(tr.Match("ABC"), expected);
+	EXPECT_EQ(tr.Match("").size(), 4);
+}
+
+TEST(RadixTrie, Insert) {
+	RadixTrie tr{ "XYZ", "ABC", "ABDD" };
+	EXPECT_EQ(tr.Size(), 3);
+	EXPECT_EQ(tr.NumNodes(), 4); // XYZ, AB, C, DD
+	tr.Insert("AB");
+	EXPECT_EQ(tr.Size(), 4);
+	EXPECT_EQ(tr.NumNodes(), 4);
+	EXPECT_TRUE(tr.Find("AB"));
+	EXPECT_FALSE(tr.Find("ABD"));
+	EXPECT_FALSE(tr.Find("X"));
+}
+
+TEST(RadixTrie, RemoveAndDeleteNodes) {
+	RadixTrie tr{ "XYZ", "ABC", "ABDD" };
+	EXPECT_TRUE(tr.RemoveAndDeleteNodes("XYZ"));
+	EXPECT_TRUE(tr.RemoveAndDeleteNodes("ABC"));
+	EXPECT_FALSE(tr.RemoveAndDeleteNodes("ABC"));
+	EXPECT_EQ(tr.Size(), 1);
+	EXPECT_EQ(tr.NumNodes(), 1); // ABDD merged back into one node
+	EXPECT_TRUE(tr.Find("ABDD"));
+}
+
+TEST(RadixTrie, MatchInsideLabel) {
+	RadixTrie tr{ "ABC", "ABCD", "ABCDE", "ABXYZ" };
+	EXPECT_EQ(tr.Match("").size(), 4);
+	EXPECT_EQ(tr.Match("ABC").size(), 3);
+	EXPECT_EQ(tr.Match("ABX").size(), 1);
+	EXPECT_TRUE(tr.Match("ABXX").empty());
+}
+
+TEST(FrozenTrie, FromImage) {
+	Trie tr{ "ABC", "ABCD", "ABCDE", "ABXYZ", "XYZ" };
+	const auto image = tr.Freeze();
+	FrozenTrie frozen{ image };
+	EXPECT_EQ(frozen.Size(), tr.Size());
+	EXPECT_EQ(frozen.NumNodes(), tr.NumNodes());
+	EXPECT_TRUE(frozen.Find("ABCD"));
+	EXPECT_FALSE(frozen.Find("AB"));
+	EXPECT_FALSE(frozen.Find("ABCDEF"));
+	EXPECT_EQ(frozen.Match("AB"), tr.Match("AB"));
+	EXPECT_EQ(frozen.ForEachMatch("", [](std::string_view) {}, 2), 2);
+}
+
+TEST(FrozenTrie, BadImage) {
+	Trie tr{ "ABC" };
+	auto image = tr.Freeze();
+	image[0] = 'X';
+	EXPECT_THROW(FrozenTrie{ image }, std::runtime_error);
+	EXPECT_THROW(FrozenTrie(std::span{ image.data(), 10 }), std::runtime_error);
+}
+
+TEST(FrozenTrie, CorruptImage) {
+	Trie tr{ "ABC", "ABD" };
+	auto image = tr.Freeze();
+	frozen::Node root{};
+	std::memcpy(&root, image.data() + sizeof(frozen::Header), sizeof(root));
+	root.firstChild = 0xFFFFFFF0; // past the end of the nodes
+	std::memcpy(image.data() + sizeof(frozen::Header), &root, sizeof(root));
+	EXPECT_THROW(FrozenTrie{ image }, std::runtime_error);
+
+	root.firstChild = 0; // the root as its own child
+	std::memcpy(image.data() + sizeof(frozen::Header), &root, sizeof(root));
+	EXPECT_THROW(FrozenTrie{ image }, std::runtime_error);
+}
+
+TEST(FrozenTrie, LoadFile) {
+	Trie tr{ "XYZ", "ABC", "ABDD" };
+	const auto path = std::filesystem::temp_directory_path() / "trie_test.trieimg";
+	tr.Freeze(path);
+	{
+		const auto frozen = FrozenTrie::Load(path);
+		EXPECT_EQ(frozen.Size(), 3);
+		EXPECT_TRUE(frozen.Find("ABDD"));
+		EXPECT_EQ(frozen.Match("").size(), 3);
+	}
+	std::filesystem::remove(path);
+}
+
+TEST(ConcurrentTrie, Basic) {
+	ConcurrentTrie tr{ "XYZ", "ABC", "ABDD" };
+	EXPECT_EQ(tr.Size(), 3);
+	EXPECT_EQ(tr.NumNodes(), 8);
+	EXPECT_TRUE(tr.Find("ABC"));
+	EXPECT_TRUE(tr.Remove("ABC"));
+	EXPECT_FALSE(tr.Find("ABC"));
+	EXPECT_EQ(tr.NumNodes(), 8);
+	tr.RemoveAndDeleteNodes("XYZ");
+	EXPECT_EQ(tr.Size(), 1);
+	EXPECT_EQ(tr.NumNodes(), 5);
+	EXPECT_EQ(tr.Match("AB").size(), 1);
+}
+
+TEST(ConcurrentTrie, ReadersAndWriter) {
+	ConcurrentTrie tr{ "stable", "words" };
+	std::atomic<bool> stop{ false };
+	std::atomic<size_t> misses{ 0 };
+	{
+		std::vector<std::jthread> readers;
+		for (int t = 0; t < 4; ++t) {
+			readers.emplace_back([&tr, &stop, &misses]() {
+				while (!stop) {
+					if (!tr.Find("stable") || !tr.Find("words"))
+						++misses;
+				}
+			});
+		}
+
+		for (int i = 0; i < 200; ++i) {
+			const auto word = "stable" + std::to_string(i);
+			tr.Insert(word);
+			tr.RemoveAndDeleteNodes(word);
+		}
+		stop = true;
+	}
+	EXPECT_EQ(misses, 0);
+	EXPECT_EQ(tr.Size(), 2);
+	EXPECT_EQ(tr.NumNodes(), 11);
 }
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "concurrent_trie.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace {
+	unsigned char ToByte(char ch) { return static_cast<unsigned char>(ch); }
+
+	size_t ThreadStripe(size_t numStripes) {
+		thread_local const size_t hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+		return hash % numStripes;
+	}
+}
+
+ConcurrentTrie::ReadGuard::ReadGuard(const ConcurrentTrie& trie) noexcept
+	: counter(trie.readers[ThreadStripe(NumStripes)].active[trie.phase.load() & 1]) {
+	// must be visible before the root is loaded, pairs with the loads in WaitForReaders()
+	counter.fetch_add(1);
+}
+
+ConcurrentTrie::ReadGuard::~ReadGuard() {
+	counter.fetch_sub(1, std::memory_order_release);
+}
+
+ConcurrentTrie::ConcurrentTrie(std::initializer_list<std::string_view> words) {
+	for (auto& w : words)
+		Insert(w);
+}
+
+ConcurrentTrie::~ConcurrentTrie() {
+	DeleteSubtree(root.load());
+}
+
+void ConcurrentTrie::Insert(std::string_view word) {
+	if (word.empty())
+		return;
+
+	std::lock_guard lock(writerMutex);
+
+	const auto path = FindPath(word);
+	if (path.back() && path.back()->isWord)
+		return;
+
+	auto newPath = CopyPath(path, path.size());
+	newPath.back()->isWord = true;
+	LinkPath(newPath, word);
+
+	const auto created = std::count(path.begin() + 1, path.end(), nullptr);
+	Publish(newPath, path);
+	numNodes.fetch_add(created, std::memory_order_relaxed);
+	size.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ConcurrentTrie::Find(std::string_view word) const {
+	if (word.empty())
+		return false;
+
+	ReadGuard guard(*this);
+	const Node* pNode = root.load();
+	for (const auto& ch : word) {
+		if (!pNode)
+			return false;
+		pNode = FindChild(pNode, ch);
+	}
+
+	return pNode ? pNode->isWord : false;
+}
+
+bool ConcurrentTrie::Remove(std::string_view word) {
+	if (word.empty())
+		return false;
+
+	std::lock_guard lock(writerMutex);
+
+	const auto path = FindPath(word);
+	if (!path.back() || !path.back()->isWord)
+		return false;
+
+	auto newPath = CopyPath(path, path.size());
+	newPath.back()->isWord = false;
+	LinkPath(newPath, word);
+
+	Publish(newPath, path);
+	size.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool ConcurrentTrie::RemoveAndDeleteNodes(std::string_view word) {
+	if (word.empty())
+		return false;
+
+	std::lock_guard lock(writerMutex);
+
+	const auto path = FindPath(word);
+	if (!path.back() || !path.back()->isWord)
+		return false;
+
+	// the deepest node that has to stay, everything below it is dropped
+	size_t keep = word.size();
+	if (path.back()->children.empty()) {
+		keep = word.size() - 1;
+		while (keep > 0 && !path[keep]->isWord && path[keep]->children.size() == 1)
+			--keep;
+	}
+
+	auto newPath = CopyPath(path, keep + 1);
+	if (keep == word.size())
+		newPath.back()->isWord = false;
+	else {
+		auto& children = newPath.back()->children;
+		children.erase(std::find_if(children.begin(), children.end(), [ch = word[keep]](const Edge& e) { return e.ch == ch; }));
+	}
+	LinkPath(newPath, word);
+
+	Publish(newPath, path);
+	numNodes.fetch_sub(word.size() - keep, std::memory_order_relaxed);
+	size.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+std::vector<std::string> ConcurrentTrie::Match(std::string_view prefix) const {
+	std::vector<std::string> out;
+
+	ReadGuard guard(*this);
+	const Node* pNode = root.load();
+	for (const auto& ch : prefix) {
+		if (!pNode)
+			break;
+		pNode = FindChild(pNode, ch);
+	}
+	if (!pNode)
+		return out;
+
+	struct StackEntry {
+		const Node* pNode;
+		size_t wordLen;
+		char ch;
+	};
+	std::vector<StackEntry> stack;
+	std::string word{ prefix };
+
+	const auto pushChildren = [&stack](const Node* pNode, size_t wordLen) {
+		for (auto it = pNode->children.rbegin(); it != pNode->children.rend(); ++it)
+			stack.push_back({ it->pNode, wordLen, it->ch });
+	};
+
+	if (pNode->isWord)
+		out.push_back(word);
+	pushChildren(pNode, word.size());
+
+	while (!stack.empty()) {
+		const auto entry = stack.back();
+		stack.pop_back();
+
+		word.resize(entry.wordLen);
+		word.push_back(entry.ch);
+
+		if (entry.pNode->isWord)
+			out.push_back(word);
+		pushChildren(entry.pNode, word.size());
+	}
+
+	return out;
+}
+
+const ConcurrentTrie::Node* ConcurrentTrie::FindChild(const Node* pNode, char ch) noexcept {
+	for (const auto& e : pNode->children) {
+		if (e.ch == ch)
+			return e.pNode;
+	}
+	return nullptr;
+}
+
+std::vector<const ConcurrentTrie::Node*> ConcurrentTrie::FindPath(std::string_view word) const {
+	std::vector<const Node*> path;
+	path.reserve(word.size() + 1);
+
+	const Node* pNode = root.load(std::memory_order_relaxed); // only writers change the root
+	path.push_back(pNode);
+	for (const auto& ch : word) {
+		pNode = pNode ? FindChild(pNode, ch) : nullptr;
+		path.push_back(pNode);
+	}
+
+	return path;
+}
+
+std::vector<std::unique_ptr<ConcurrentTrie::Node>> ConcurrentTrie::CopyPath(const std::vector<const Node*>& path, size_t length) {
+	std::vector<std::unique_ptr<Node>> newPath;
+	newPath.reserve(length);
+	for (size_t i = 0; i < length; ++i) {
+		newPath.push_back(path[i] ? std::make_unique<Node>(*path[i]) : std::make_unique<Node>());
+		// so that LinkPath() does not allocate
+		newPath.back()->children.reserve(newPath.back()->children.size() + 1);
+	}
+	return newPath;
+}
+
+void ConcurrentTrie::LinkPath(std::vector<std::unique_ptr<Node>>& newPath, std::string_view word) noexcept {
+	for (size_t depth = 1; depth < newPath.size(); ++depth) {
+		const auto ch = word[depth - 1];
+		auto& children = newPath[depth - 1]->children;
+		const auto it = std::find_if(children.begin(), children.end(), [ch](const Edge& e) { return ToByte(ch) <= ToByte(e.ch); });
+		if (it != children.end() && it->ch == ch)
+			it->pNode = newPath[depth].get();
+		else
+			children.insert(it, Edge{ ch, newPath[depth].get() });
+	}
+}
+
+void ConcurrentTrie::Publish(std::vector<std::unique_ptr<Node>>& newPath, const std::vector<const Node*>& retired) {
+	root.store(newPath.front().get());
+	for (auto& pNode : newPath)
+		pNode.release(); // owned by the trie now
+
+	WaitForReaders();
+
+	for (auto pNode : retired)
+		delete pNode;
+}
+
+void ConcurrentTrie::WaitForReaders() {
+	// Two phase flips: new readers go to the other counter, so the one we
+	// wait for can only drain. After both flips every reader that might have
+	// loaded the previous root has left its critical section.
+	for (int flip = 0; flip < 2; ++flip) {
+		const auto oldPhase = phase.fetch_add(1);
+		for (auto& stripe : readers) {
+			while (stripe.active[oldPhase & 1].load() != 0)
+				std::this_thread::yield();
+		}
+	}
+}
+
+void ConcurrentTrie::DeleteSubtree(const Node* pNode) {
+	if (!pNode)
+		return;
+
+	std::vector<const Node*> stack{ pNode };
+	while (!stack.empty()) {
+		const auto pTop = stack.back();
+		stack.pop_back();
+		for (const auto& e : pTop->children)
+			stack.push_back(e.pNode);
+		delete pTop;
+	}
+}
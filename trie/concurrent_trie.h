@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Trie that can be shared between threads: Find and Match never block and
+// never wait for writers, Insert and Remove are serialized by a mutex.
+// Nodes are immutable once published. A writer copies the path from the root
+// to the changed node (path copying) and publishes the new root with a single
+// atomic store, so readers always see a consistent version.
+// Replaced nodes are freed after an RCU grace period: readers announce
+// themselves in one of two striped counters, and the writer waits until all
+// readers that could still see the old version have left.
+class ConcurrentTrie {
+
+	struct Node;
+
+	struct Edge {
+		char ch;
+		const Node* pNode;
+	};
+
+	struct Node {
+		std::vector<Edge> children; // sorted by ch
+		bool isWord{ false };
+	};
+
+public:
+
+	ConcurrentTrie() = default;
+	ConcurrentTrie(std::initializer_list<std::string_view> words);
+	~ConcurrentTrie();
+
+	ConcurrentTrie(const ConcurrentTrie&) = delete;
+	ConcurrentTrie& operator=(const ConcurrentTrie&) = delete;
+
+	size_t Size() const noexcept { return size.load(std::memory_order_relaxed); }
+	size_t NumNodes() const noexcept { return numNodes.load(std::memory_order_relaxed); }
+
+	void Insert(std::string_view word);
+
+	bool Find(std::string_view word) const;
+
+	bool Remove(std::string_view word);
+
+	bool RemoveAndDeleteNodes(std::string_view word);
+
+	std::vector<std::string> Match(std::string_view prefix) const;
+
+private:
+	// RAII read side critical section
+	class ReadGuard {
+	public:
+		explicit ReadGuard(const ConcurrentTrie& trie) noexcept;
+		~ReadGuard();
+		ReadGuard(const ReadGuard&) = delete;
+		ReadGuard& operator=(const ReadGuard&) = delete;
+
+	private:
+		std::atomic<int64_t>& counter;
+	};
+
+	static const Node* FindChild(const Node* pNode, char ch) noexcept;
+
+	// writer side helpers, require writerMutex
+	std::vector<const Node*> FindPath(std::string_view word) const; // nullptr for missing nodes
+	static std::vector<std::unique_ptr<Node>> CopyPath(const std::vector<const Node*>& path, size_t length);
+	static void LinkPath(std::vector<std::unique_ptr<Node>>& newPath, std::string_view word) noexcept;
+	void Publish(std::vector<std::unique_ptr<Node>>& newPath, const std::vector<const Node*>& retired);
+	void WaitForReaders();
+
+	static void DeleteSubtree(const Node* pNode);
+
+private:
+	static constexpr size_t NumStripes = 16;
+
+	struct alignas(64) ReaderCounters {
+		std::array<std::atomic<int64_t>, 2> active{};
+	};
+
+	std::atomic<const Node*> root{ nullptr };
+	std::atomic<uint64_t> phase{ 0 };
+	mutable std::array<ReaderCounters, NumStripes> readers;
+
+	std::mutex writerMutex;
+	std::atomic<size_t> size{ 0 };
+	std::atomic<size_t> numNodes{ 0 }; // excluding root
+};
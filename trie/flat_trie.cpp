@@ -0,0 +1,338 @@
+#include "flat_trie.h"
+
+#include <algorithm>
+#include <execution>
+
+namespace {
+	unsigned char ToByte(char ch) { return static_cast<unsigned char>(ch); }
+
+	size_t CommonPrefixLength(std::string_view a, std::string_view b) {
+		const auto len = std::min(a.size(), b.size());
+		return std::mismatch(a.begin(), a.begin() + len, b.begin()).first - a.begin();
+	}
+}
+
+FlatTrie::FlatTrie() {
+	nodes.emplace_back(); // root
+}
+
+FlatTrie::FlatTrie(std::initializer_list<std::string_view> words) : FlatTrie() {
+	for (auto& w : words)
+		Insert(w);
+}
+
+FlatTrie FlatTrie::BulkBuild(std::vector<std::string_view> words) {
+	std::erase(words, std::string_view{});
+	if (!std::is_sorted(words.begin(), words.end()))
+		std::sort(std::execution::par, words.begin(), words.end());
+
+	// every word adds only the chars it doesn't share with its predecessor
+	size_t totalNodes = 0;
+	std::string_view prev;
+	for (const auto& word : words) {
+		totalNodes += word.size() - CommonPrefixLength(prev, word);
+		prev = word;
+	}
+
+	FlatTrie trie;
+	trie.nodes.reserve(totalNodes + 1);
+	// no reserve for the edges: a node's array is replaced by one twice as large as it
+	// grows, and the old arrays are only reused by later nodes of the same size, so the
+	// final size is not known up front and an upper bound would keep up to twice the slots
+
+	// path[i] is the node for the first i chars of the previous word,
+	// new children are always the largest ones so AddChild() appends them
+	std::vector<NodeIndex> path{ RootIndex };
+	prev = {};
+	for (const auto& word : words) {
+		path.resize(CommonPrefixLength(prev, word) + 1);
+		for (size_t i = path.size() - 1; i < word.size(); ++i)
+			path.push_back(trie.AddChild(path.back(), word[i]));
+
+		if (!trie.nodes[path.back()].isWord) {
+			trie.nodes[path.back()].isWord = true;
+			++trie.size;
+		}
+		prev = word;
+	}
+
+	return trie;
+}
+
+size_t FlatTrie::BytesUsed() const noexcept {
+	size_t bytes = sizeof(*this)
+		+ nodes.capacity() * sizeof(FlatNode)
+		+ edges.capacity() * sizeof(Edge)
+		+ denseTables.capacity() * sizeof(DenseTable)
+		+ freeNodes.capacity() * sizeof(NodeIndex)
+		+ freeDenseTables.capacity() * sizeof(uint32_t);
+	for (auto& freeList : freeEdges)
+		bytes += freeList.capacity() * sizeof(uint32_t);
+	return bytes;
+}
+
+void FlatTrie::Insert(std::string_view word) {
+	if (word.empty())
+		return;
+
+	NodeIndex idx = RootIndex;
+	for (const auto& ch : word) {
+		auto child = FindChild(nodes[idx], ch);
+		if (child == InvalidIndex)
+			child = AddChild(idx, ch);
+		idx = child;
+	}
+
+	if (!nodes[idx].isWord) {
+		nodes[idx].isWord = true;
+		++size;
+	}
+}
+
+bool FlatTrie::Find(std::string_view word) const {
+	const auto idx = FindNode(word);
+	return idx != InvalidIndex ? nodes[idx].isWord : false;
+}
+
+bool FlatTrie::Remove(std::string_view word) {
+	const auto idx = FindNode(word);
+	if (idx != InvalidIndex && nodes[idx].isWord) {
+		nodes[idx].isWord = false;
+		--size;
+		return true;
+	}
+	return false;
+}
+
+bool FlatTrie::RemoveAndDeleteNodes(std::string_view word) {
+	if (word.empty())
+		return false;
+
+	std::vector<NodeIndex> path{ RootIndex };
+	path.reserve(word.size() + 1);
+	for (const auto& ch : word) {
+		const auto child = FindChild(nodes[path.back()], ch);
+		if (child == InvalidIndex)
+			return false;
+		path.push_back(child);
+	}
+
+	if (!nodes[path.back()].isWord)
+		return false;
+
+	nodes[path.back()].isWord = false;
+	--size;
+
+	// prune the dangling tail, stop at the first node that is still needed
+	for (size_t depth = word.size(); depth > 0; --depth) {
+		const auto idx = path[depth];
+		if (nodes[idx].isWord || nodes[idx].numChildren > 0)
+			break;
+
+		EraseChild(path[depth - 1], word[depth - 1]);
+
+		auto& node = nodes[idx];
+		if (node.isDense)
+			freeDenseTables.push_back(node.children);
+		else if (node.children != InvalidIndex)
+			FreeEdges(node.children, node.edgeClass);
+		node = FlatNode{};
+		freeNodes.push_back(idx);
+		--numNodes;
+	}
+
+	return true;
+}
+
+std::vector<std::string> FlatTrie::Match(std::string_view prefix) const {
+	std::vector<std::string> out;
+
+	const auto startIdx = prefix.empty() ? RootIndex : FindNode(prefix);
+	if (startIdx == InvalidIndex)
+		return out;
+
+	// depth-first, children are pushed in reverse so that words come out sorted
+	struct StackEntry {
+		NodeIndex node;
+		size_t wordLen;
+		char ch;
+	};
+	std::vector<StackEntry> stack;
+	std::string word{ prefix };
+
+	const auto pushChildren = [this, &stack](const FlatNode& node, size_t wordLen) {
+		const auto first = stack.size();
+		ForEachChild(node, [&stack, wordLen](char ch, NodeIndex child) {
+			stack.push_back({ child, wordLen, ch });
+		});
+		std::reverse(stack.begin() + first, stack.end());
+	};
+
+	if (nodes[startIdx].isWord)
+		out.push_back(word);
+	pushChildren(nodes[startIdx], word.size());
+
+	while (!stack.empty()) {
+		const auto entry = stack.back();
+		stack.pop_back();
+
+		word.resize(entry.wordLen);
+		word.push_back(entry.ch);
+
+		const auto& node = nodes[entry.node];
+		if (node.isWord)
+			out.push_back(word);
+		pushChildren(node, word.size());
+	}
+
+	return out;
+}
+
+FlatTrie::NodeIndex FlatTrie::FindNode(std::string_view word) const {
+	if (word.empty())
+		return InvalidIndex;
+
+	NodeIndex idx = RootIndex;
+	for (const auto& ch : word) {
+		idx = FindChild(nodes[idx], ch);
+		if (idx == InvalidIndex)
+			return InvalidIndex;
+	}
+
+	return idx;
+}
+
+FlatTrie::NodeIndex FlatTrie::FindChild(const FlatNode& node, char ch) const {
+	if (node.isDense)
+		return denseTables[node.children][ToByte(ch)];
+
+	// small arrays, so the linear scan beats binary search
+	const auto first = edges.data() + node.children;
+	const auto last = first + node.numChildren;
+	for (auto it = first; it != last; ++it) {
+		if (it->ch == ch)
+			return it->node;
+	}
+	return InvalidIndex;
+}
+
+FlatTrie::NodeIndex FlatTrie::AddChild(NodeIndex parent, char ch) {
+	if (!nodes[parent].isDense && nodes[parent].numChildren == MaxSparseChildren)
+		ConvertToDense(parent);
+
+	const auto child = AllocNode(); // might invalidate references to nodes
+	++numNodes;
+
+	auto& node = nodes[parent];
+	if (node.isDense) {
+		denseTables[node.children][ToByte(ch)] = child;
+		++node.numChildren;
+		return child;
+	}
+
+	if (node.children == InvalidIndex) {
+		node.edgeClass = 0;
+		node.children = AllocEdges(node.edgeClass);
+	}
+	else if (node.numChildren == (1u << node.edgeClass)) {
+		const auto oldOffset = node.children;
+		const auto oldClass = node.edgeClass;
+		node.edgeClass = oldClass + 1;
+		node.children = AllocEdges(node.edgeClass); // might reallocate edges
+		std::copy_n(edges.begin() + oldOffset, node.numChildren, edges.begin() + node.children);
+		FreeEdges(oldOffset, oldClass);
+	}
+
+	// keep the array sorted
+	const auto first = edges.begin() + node.children;
+	const auto last = first + node.numChildren;
+	const auto pos = std::find_if(first, last, [ch](const Edge& e) { return ToByte(ch) < ToByte(e.ch); });
+	std::move_backward(pos, last, last + 1);
+	*pos = Edge{ ch, child };
+	++node.numChildren;
+
+	return child;
+}
+
+void FlatTrie::EraseChild(NodeIndex parent, char ch) {
+	auto& node = nodes[parent];
+	if (node.isDense) {
+		denseTables[node.children][ToByte(ch)] = InvalidIndex;
+		--node.numChildren;
+		return;
+	}
+
+	const auto first = edges.begin() + node.children;
+	const auto last = first + node.numChildren;
+	const auto pos = std::find_if(first, last, [ch](const Edge& e) { return e.ch == ch; });
+	if (pos != last) {
+		std::move(pos + 1, last, pos);
+		--node.numChildren;
+	}
+}
+
+void FlatTrie::ConvertToDense(NodeIndex idx) {
+	uint32_t tableIdx = 0;
+	if (!freeDenseTables.empty()) {
+		tableIdx = freeDenseTables.back();
+		freeDenseTables.pop_back();
+	}
+	else {
+		tableIdx = static_cast<uint32_t>(denseTables.size());
+		denseTables.emplace_back();
+	}
+
+	auto& table = denseTables[tableIdx];
+	table.fill(InvalidIndex);
+
+	auto& node = nodes[idx];
+	ForEachChild(node, [&table](char ch, NodeIndex child) { table[ToByte(ch)] = child; });
+	FreeEdges(node.children, node.edgeClass);
+
+	node.children = tableIdx;
+	node.isDense = true;
+}
+
+template <typename TFunc> void FlatTrie::ForEachChild(const FlatNode& node, TFunc func) const {
+	if (node.isDense) {
+		const auto& table = denseTables[node.children];
+		for (size_t i = 0; i < table.size(); ++i) {
+			if (table[i] != InvalidIndex)
+				func(static_cast<char>(i), table[i]);
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i < node.numChildren; ++i) {
+		const auto& e = edges[node.children + i];
+		func(e.ch, e.node);
+	}
+}
+
+FlatTrie::NodeIndex FlatTrie::AllocNode() {
+	if (!freeNodes.empty()) {
+		const auto idx = freeNodes.back();
+		freeNodes.pop_back();
+		return idx;
+	}
+
+	nodes.emplace_back();
+	return static_cast<NodeIndex>(nodes.size() - 1);
+}
+
+uint32_t FlatTrie::AllocEdges(uint8_t edgeClass) {
+	auto& freeList = freeEdges[edgeClass];
+	if (!freeList.empty()) {
+		const auto offset = freeList.back();
+		freeList.pop_back();
+		return offset;
+	}
+
+	const auto offset = static_cast<uint32_t>(edges.size());
+	edges.resize(edges.size() + (size_t{ 1 } << edgeClass));
+	return offset;
+}
+
+void FlatTrie::FreeEdges(uint32_t offset, uint8_t edgeClass) {
+	freeEdges[edgeClass].push_back(offset);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Same interface as Trie, but all nodes live in one contiguous pool and
+// children are referenced by 32-bit indices instead of pointers.
+// Nodes with a few children keep a small sorted array of edges, nodes
+// with a high fanout switch to a dense 256-entry lookup table.
+class FlatTrie {
+
+	using NodeIndex = uint32_t;
+	static constexpr NodeIndex InvalidIndex = std::numeric_limits<NodeIndex>::max();
+	static constexpr NodeIndex RootIndex = 0;
+
+	// edge arrays grow in power of two blocks: 1, 2, 4, 8, 16
+	static constexpr size_t NumEdgeClasses = 5;
+	static constexpr uint16_t MaxSparseChildren = 1 << (NumEdgeClasses - 1);
+
+	struct Edge {
+		char ch;
+		NodeIndex node;
+	};
+
+	struct FlatNode {
+		uint32_t children{ InvalidIndex }; // offset into edges or index into denseTables
+		uint16_t numChildren{ 0 };
+		uint8_t edgeClass{ 0 }; // capacity == 1 << edgeClass, unused for dense nodes
+		bool isDense{ false };
+		bool isWord{ false };
+	};
+
+	using DenseTable = std::array<NodeIndex, 256>;
+
+public:
+
+	FlatTrie();
+	FlatTrie(std::initializer_list<std::string_view> words);
+
+	size_t Size() const noexcept { return size; }
+	size_t NumNodes() const noexcept { return numNodes; }
+	size_t BytesUsed() const noexcept;
+
+	// one pass over sorted words (sorted first if needed), the node pool is
+	// allocated once with the exact number of nodes
+	template <std::ranges::input_range TRange>
+	static FlatTrie BulkBuild(const TRange& words);
+	static FlatTrie BulkBuild(std::vector<std::string_view> words);
+
+	void Insert(std::string_view word);
+
+	bool Find(std::string_view word) const;
+
+	bool Remove(std::string_view word);
+
+	bool RemoveAndDeleteNodes(std::string_view word);
+
+	std::vector<std::string> Match(std::string_view prefix) const;
+
+private:
+	NodeIndex FindNode(std::string_view word) const;
+	NodeIndex FindChild(const FlatNode& node, char ch) const;
+	NodeIndex AddChild(NodeIndex parent, char ch);
+	void EraseChild(NodeIndex parent, char ch);
+	void ConvertToDense(NodeIndex idx);
+
+	template <typename TFunc> void ForEachChild(const FlatNode& node, TFunc func) const;
+
+	NodeIndex AllocNode();
+	uint32_t AllocEdges(uint8_t edgeClass);
+	void FreeEdges(uint32_t offset, uint8_t edgeClass);
+
+private:
+	std::vector<FlatNode> nodes; // nodes[RootIndex] is the root
+	std::vector<Edge> edges;
+	std::vector<DenseTable> denseTables;
+
+	// recycled slots after RemoveAndDeleteNodes and edge array growth
+	std::vector<NodeIndex> freeNodes;
+	std::vector<uint32_t> freeDenseTables;
+	std::array<std::vector<uint32_t>, NumEdgeClasses> freeEdges;
+
+	size_t size{ 0 };
+	size_t numNodes{ 0 }; // excluding root
+};
+
+template <std::ranges::input_range TRange>
+FlatTrie FlatTrie::BulkBuild(const TRange& words) {
+	std::vector<std::string_view> views;
+	if constexpr (std::ranges::sized_range<TRange>)
+		views.reserve(std::ranges::size(words));
+	for (const auto& w : words)
+		views.emplace_back(w);
+	return BulkBuild(std::move(views));
+}
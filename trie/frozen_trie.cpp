@@ -0,0 +1,174 @@
+#include "frozen_trie.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	struct MappedView {
+		void* address{ nullptr };
+		size_t size{ 0 };
+	};
+
+#ifdef _WIN32
+	MappedView MapFile(const std::filesystem::path& path) {
+		const auto hFile = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("Cannot open " + path.filename().string());
+
+		LARGE_INTEGER fileSize{};
+		::GetFileSizeEx(hFile, &fileSize);
+		const auto hMapping = fileSize.QuadPart > 0 ? ::CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+		::CloseHandle(hFile);
+		if (!hMapping)
+			throw std::runtime_error("Cannot map " + path.filename().string());
+
+		// the view keeps the mapping alive
+		const auto pView = ::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+		::CloseHandle(hMapping);
+		if (!pView)
+			throw std::runtime_error("Cannot map " + path.filename().string());
+
+		return { pView, static_cast<size_t>(fileSize.QuadPart) };
+	}
+
+	void UnmapFile(const MappedView& view) noexcept {
+		::UnmapViewOfFile(view.address);
+	}
+#else
+	MappedView MapFile(const std::filesystem::path& path) {
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("Cannot open " + path.filename().string());
+
+		struct stat st {};
+		if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			throw std::runtime_error("Cannot map " + path.filename().string());
+		}
+
+		// the mapping stays valid after closing the descriptor
+		const auto size = static_cast<size_t>(st.st_size);
+		const auto pView = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (pView == MAP_FAILED)
+			throw std::runtime_error("Cannot map " + path.filename().string());
+
+		return { pView, size };
+	}
+
+	void UnmapFile(const MappedView& view) noexcept {
+		::munmap(view.address, view.size);
+	}
+#endif
+}
+
+FrozenTrie::FrozenTrie(std::span<const char> image) {
+	if (image.size() < sizeof(frozen::Header))
+		throw std::runtime_error("Trie image is too small");
+
+	frozen::Header header{};
+	std::memcpy(&header, image.data(), sizeof(header));
+	if (std::memcmp(header.magic, frozen::Magic, sizeof(frozen::Magic)) != 0 || header.version != frozen::Version)
+		throw std::runtime_error("Not a trie image, or unsupported version");
+
+	if (header.numNodes == 0 || image.size() < frozen::ImageSize(header.numNodes))
+		throw std::runtime_error("Trie image is truncated");
+
+	nodes = reinterpret_cast<const frozen::Node*>(image.data() + sizeof(frozen::Header));
+	labels = reinterpret_cast<const char*>(nodes + header.numNodes);
+
+	// the lookups index nodes and labels without checks, so the child ranges are checked once here;
+	// children come after their parent in level order, which also rules out cycles
+	for (uint32_t i = 0; i < header.numNodes; ++i) {
+		const auto& node = nodes[i];
+		if (node.numChildren > 0 && (node.firstChild <= i || uint64_t{ node.firstChild } + node.numChildren > header.numNodes))
+			throw std::runtime_error("Trie image is corrupt");
+	}
+
+	numNodes = header.numNodes;
+	numWords = header.numWords;
+}
+
+FrozenTrie::~FrozenTrie() {
+	Unmap();
+}
+
+FrozenTrie::FrozenTrie(FrozenTrie&& other) noexcept {
+	*this = std::move(other);
+}
+
+FrozenTrie& FrozenTrie::operator=(FrozenTrie&& other) noexcept {
+	if (this != &other) {
+		Unmap();
+		nodes = std::exchange(other.nodes, nullptr);
+		labels = std::exchange(other.labels, nullptr);
+		numNodes = std::exchange(other.numNodes, 0);
+		numWords = std::exchange(other.numWords, 0);
+		mappedAddress = std::exchange(other.mappedAddress, nullptr);
+		mappedSize = std::exchange(other.mappedSize, 0);
+	}
+	return *this;
+}
+
+FrozenTrie FrozenTrie::Load(const std::filesystem::path& path) {
+	const auto view = MapFile(path);
+	try {
+		FrozenTrie trie{ std::span{ static_cast<const char*>(view.address), view.size } };
+		trie.mappedAddress = view.address;
+		trie.mappedSize = view.size;
+		return trie;
+	}
+	catch (...) {
+		UnmapFile(view);
+		throw;
+	}
+}
+
+bool FrozenTrie::Find(std::string_view word) const {
+	const auto node = FindNode(word);
+	return node != InvalidIndex ? nodes[node].isWord != 0 : false;
+}
+
+std::vector<std::string> FrozenTrie::Match(std::string_view prefix) const {
+	std::vector<std::string> out;
+	ForEachMatch(prefix, [&out](std::string_view word) { out.emplace_back(word); });
+	return out;
+}
+
+uint32_t FrozenTrie::FindChild(uint32_t node, char ch) const noexcept {
+	const auto first = nodes[node].firstChild;
+	const auto pLabel = static_cast<const char*>(std::memchr(labels + first, ch, nodes[node].numChildren));
+	return pLabel ? static_cast<uint32_t>(pLabel - labels) : InvalidIndex;
+}
+
+uint32_t FrozenTrie::FindNode(std::string_view word) const noexcept {
+	if (word.empty() || numNodes == 0)
+		return InvalidIndex;
+
+	uint32_t node = 0;
+	for (const auto& ch : word) {
+		node = FindChild(node, ch);
+		if (node == InvalidIndex)
+			return InvalidIndex;
+	}
+
+	return node;
+}
+
+void FrozenTrie::Unmap() noexcept {
+	if (mappedAddress)
+		UnmapFile({ mappedAddress, mappedSize });
+	mappedAddress = nullptr;
+	mappedSize = 0;
+}
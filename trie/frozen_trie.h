@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Binary image of a Trie, written by Trie::Freeze(), pointer free so it can be
+// used directly from a memory mapped file.
+// Nodes are stored in level order (BFS), so all children of a node have
+// consecutive indices and the node only needs the index of its first child.
+// The char on the edge leading into node i is stored in labels[i].
+// Layout: Header | Node nodes[numNodes] | char labels[numNodes]
+// All values use the native byte order.
+namespace frozen {
+	inline constexpr char Magic[8] = { 'T', 'R', 'I', 'E', 'I', 'M', 'G', '\0' };
+	inline constexpr uint32_t Version = 1;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t numNodes; // including root
+		uint64_t numWords;
+		uint64_t reserved;
+	};
+
+	struct Node {
+		uint32_t firstChild;
+		uint16_t numChildren;
+		uint8_t isWord;
+		uint8_t padding;
+	};
+
+	static_assert(sizeof(Header) == 32 && sizeof(Node) == 8);
+
+	inline size_t ImageSize(size_t numNodes) {
+		return sizeof(Header) + numNodes * (sizeof(Node) + sizeof(char));
+	}
+}
+
+// Read only view of a frozen Trie, either from a memory mapped file
+// or from a buffer owned by the caller.
+class FrozenTrie {
+public:
+	FrozenTrie() = default;
+	explicit FrozenTrie(std::span<const char> image); // the image must outlive the FrozenTrie
+	~FrozenTrie();
+
+	FrozenTrie(const FrozenTrie&) = delete;
+	FrozenTrie& operator=(const FrozenTrie&) = delete;
+	FrozenTrie(FrozenTrie&& other) noexcept;
+	FrozenTrie& operator=(FrozenTrie&& other) noexcept;
+
+	// maps the file read only, nothing is copied or deserialized
+	static FrozenTrie Load(const std::filesystem::path& path);
+
+	size_t Size() const noexcept { return numWords; }
+	size_t NumNodes() const noexcept { return numNodes > 0 ? numNodes - 1 : 0; } // excluding root
+	size_t BytesUsed() const noexcept { return frozen::ImageSize(numNodes); }
+
+	bool Find(std::string_view word) const;
+
+	std::vector<std::string> Match(std::string_view prefix) const;
+
+	// same contract as Trie::ForEachMatch
+	template <typename TVisitor>
+	size_t ForEachMatch(std::string_view prefix, TVisitor visitor, size_t maxResults = std::numeric_limits<size_t>::max()) const;
+
+private:
+	static constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+	uint32_t FindChild(uint32_t node, char ch) const noexcept;
+	uint32_t FindNode(std::string_view word) const noexcept;
+	void Unmap() noexcept;
+
+private:
+	const frozen::Node* nodes{ nullptr };
+	const char* labels{ nullptr };
+	uint32_t numNodes{ 0 };
+	uint64_t numWords{ 0 };
+
+	// set only when the image was mapped by Load()
+	void* mappedAddress{ nullptr };
+	size_t mappedSize{ 0 };
+};
+
+template <typename TVisitor>
+size_t FrozenTrie::ForEachMatch(std::string_view prefix, TVisitor visitor, size_t maxResults) const {
+	if (numNodes == 0 || maxResults == 0)
+		return 0;
+
+	const auto start = prefix.empty() ? 0 : FindNode(prefix);
+	if (start == InvalidIndex)
+		return 0;
+
+	size_t count = 0;
+	std::string word{ prefix };
+
+	const auto visit = [&visitor, &count, &word, maxResults]() {
+		++count;
+		if constexpr (std::is_void_v<std::invoke_result_t<TVisitor&, std::string_view>>) {
+			visitor(std::string_view{ word });
+			return count < maxResults;
+		}
+		else
+			return visitor(std::string_view{ word }) && count < maxResults;
+	};
+
+	if (nodes[start].isWord && !visit())
+		return count;
+
+	struct Frame {
+		uint32_t next;
+		uint32_t end;
+	};
+	std::vector<Frame> stack{ { nodes[start].firstChild, nodes[start].firstChild + nodes[start].numChildren } };
+
+	while (!stack.empty()) {
+		auto& top = stack.back();
+		if (top.next == top.end) {
+			stack.pop_back();
+			if (!stack.empty())
+				word.pop_back();
+			continue;
+		}
+
+		const auto child = top.next++;
+		word.push_back(labels[child]);
+		if (nodes[child].isWord && !visit())
+			break;
+
+		stack.push_back({ nodes[child].firstChild, nodes[child].firstChild + nodes[child].numChildren });
+	}
+
+	return count;
+}
@@ -0,0 +1,216 @@
+#include "radix_trie.h"
+
+#include <algorithm>
+
+namespace {
+	unsigned char ToByte(char ch) { return static_cast<unsigned char>(ch); }
+
+	// children are sorted by the first char of their labels, and no two children share it
+	template <typename TVec>
+	auto LowerBound(TVec& children, char ch) {
+		return std::lower_bound(children.begin(), children.end(), ch, [](const auto& node, char c) {
+			return ToByte(node.label.front()) < ToByte(c);
+		});
+	}
+
+	template <typename TVec>
+	auto FindChild(TVec& children, char ch) {
+		const auto it = LowerBound(children, ch);
+		return (it != children.end() && it->label.front() == ch) ? it : children.end();
+	}
+
+	size_t CommonPrefixLength(std::string_view a, std::string_view b) {
+		const auto len = std::min(a.size(), b.size());
+		return std::mismatch(a.begin(), a.begin() + len, b.begin()).first - a.begin();
+	}
+
+	size_t HeapBytes(const std::string& str) {
+		// small strings live inside the object, no need to count them twice
+		const auto pObj = reinterpret_cast<const char*>(&str);
+		const bool isLocal = str.data() >= pObj && str.data() < pObj + sizeof(str);
+		return isLocal ? 0 : str.capacity() + 1;
+	}
+}
+
+RadixTrie::RadixTrie(std::initializer_list<std::string_view> words) {
+	for (auto& w : words)
+		Insert(w);
+}
+
+template <typename TNode>
+TNode* RadixTrie::FindNode(TNode* pNode, std::string_view word) {
+	if (word.empty())
+		return nullptr;
+
+	while (!word.empty()) {
+		const auto it = FindChild(pNode->children, word.front());
+		if (it == pNode->children.end() || !word.starts_with(it->label))
+			return nullptr;
+
+		word.remove_prefix(it->label.size());
+		pNode = &*it;
+	}
+
+	return pNode;
+}
+
+size_t RadixTrie::BytesUsed() const {
+	size_t bytes = sizeof(*this);
+
+	std::vector<const RadixNode*> stack{ &root };
+	while (!stack.empty()) {
+		const auto pNode = stack.back();
+		stack.pop_back();
+
+		bytes += HeapBytes(pNode->label) + pNode->children.capacity() * sizeof(RadixNode);
+		for (auto& child : pNode->children)
+			stack.push_back(&child);
+	}
+
+	return bytes;
+}
+
+void RadixTrie::Insert(std::string_view word) {
+	if (word.empty())
+		return;
+
+	RadixNode* pNode = &root;
+	while (!word.empty()) {
+		auto it = FindChild(pNode->children, word.front());
+		if (it == pNode->children.end()) {
+			pNode->children.insert(LowerBound(pNode->children, word.front()), RadixNode{ std::string{ word }, {}, true });
+			++numNodes;
+			++size;
+			return;
+		}
+
+		const auto common = CommonPrefixLength(it->label, word);
+		if (common < it->label.size()) {
+			// split the edge: the shared part becomes a new inner node
+			RadixNode split{ it->label.substr(0, common), {}, false };
+			it->label.erase(0, common);
+			split.children.push_back(std::move(*it));
+			*it = std::move(split);
+			++numNodes;
+		}
+
+		pNode = &*it;
+		word.remove_prefix(common);
+	}
+
+	if (!pNode->isWord) {
+		pNode->isWord = true;
+		++size;
+	}
+}
+
+bool RadixTrie::Find(std::string_view word) const {
+	auto pNode = FindNode(&root, word);
+	return pNode ? pNode->isWord : false;
+}
+
+bool RadixTrie::Remove(std::string_view word) {
+	auto pNode = FindNode(&root, word);
+	if (pNode && pNode->isWord) {
+		pNode->isWord = false;
+		--size;
+		return true;
+	}
+	return false;
+}
+
+bool RadixTrie::RemoveAndDeleteNodes(std::string_view word) {
+	if (word.empty())
+		return false;
+
+	RadixNode* pParent = nullptr;
+	RadixNode* pNode = &root;
+	while (!word.empty()) {
+		const auto it = FindChild(pNode->children, word.front());
+		if (it == pNode->children.end() || !word.starts_with(it->label))
+			return false;
+
+		word.remove_prefix(it->label.size());
+		pParent = pNode;
+		pNode = &*it;
+	}
+
+	if (!pNode->isWord)
+		return false;
+
+	pNode->isWord = false;
+	--size;
+
+	// restore the invariant that only the root and word nodes might have a single child
+	if (pNode->children.empty()) {
+		pParent->children.erase(FindChild(pParent->children, pNode->label.front()));
+		--numNodes;
+		if (pParent != &root && !pParent->isWord && pParent->children.size() == 1) {
+			MergeWithOnlyChild(*pParent);
+			--numNodes;
+		}
+	}
+	else if (pNode->children.size() == 1) {
+		MergeWithOnlyChild(*pNode);
+		--numNodes;
+	}
+
+	return true;
+}
+
+std::vector<std::string> RadixTrie::Match(std::string_view prefix) const {
+	std::vector<std::string> out;
+
+	// the prefix might end in the middle of an edge label
+	const RadixNode* pNode = &root;
+	std::string word;
+	while (!prefix.empty()) {
+		const auto it = FindChild(pNode->children, prefix.front());
+		if (it == pNode->children.end())
+			return out;
+
+		const auto common = CommonPrefixLength(it->label, prefix);
+		if (common < prefix.size() && common < it->label.size())
+			return out;
+
+		word += it->label;
+		prefix.remove_prefix(common);
+		pNode = &*it;
+	}
+
+	struct StackEntry {
+		const RadixNode* pNode;
+		size_t wordLen;
+	};
+	std::vector<StackEntry> stack;
+
+	const auto pushChildren = [&stack](const RadixNode& node, size_t wordLen) {
+		for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+			stack.push_back({ &*it, wordLen });
+	};
+
+	if (pNode->isWord)
+		out.push_back(word);
+	pushChildren(*pNode, word.size());
+
+	while (!stack.empty()) {
+		const auto entry = stack.back();
+		stack.pop_back();
+
+		word.resize(entry.wordLen);
+		word += entry.pNode->label;
+
+		if (entry.pNode->isWord)
+			out.push_back(word);
+		pushChildren(*entry.pNode, word.size());
+	}
+
+	return out;
+}
+
+void RadixTrie::MergeWithOnlyChild(RadixNode& node) {
+	auto child = std::move(node.children.front());
+	node.label += child.label;
+	node.isWord = child.isWord;
+	node.children = std::move(child.children);
+}
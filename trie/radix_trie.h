@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compressed (radix/Patricia) variant of Trie: chains of single-child nodes
+// are collapsed into one node that stores the whole edge label.
+// The number of nodes is bounded by 2 * Size() instead of the total number of
+// characters in all words.
+class RadixTrie {
+
+	struct RadixNode {
+		std::string label; // never empty, except for the root
+		std::vector<RadixNode> children; // sorted by the first char of the label
+		bool isWord{ false };
+	};
+
+public:
+
+	RadixTrie() = default;
+	RadixTrie(std::initializer_list<std::string_view> words);
+
+	size_t Size() const noexcept { return size; }
+	size_t NumNodes() const noexcept { return numNodes; }
+	size_t BytesUsed() const;
+
+	void Insert(std::string_view word);
+
+	bool Find(std::string_view word) const;
+
+	bool Remove(std::string_view word);
+
+	bool RemoveAndDeleteNodes(std::string_view word);
+
+	std::vector<std::string> Match(std::string_view prefix) const;
+
+private:
+	template <typename TNode> static TNode* FindNode(TNode* pNode, std::string_view word);
+
+	static void MergeWithOnlyChild(RadixNode& node);
+
+private:
+	RadixNode root;
+	size_t size{ 0 };
+	size_t numNodes{ 0 }; // excluding root
+};
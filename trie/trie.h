@@ -1,34 +1,159 @@
 #pragma once
 
+#include "frozen_trie.h"
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
 #include <map>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <ranges>
+#include <span>
+#include <stdexcept>
 #include <vector>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace trie_detail {
+	// Calls body(i) for every i in [0, count) in parallel. Defined in trie.cpp,
+	// so the parallel algorithms stay out of this header.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+}
 
-class Trie {
+// Trie that maps words to values of type V, stored in the terminal nodes.
+// TrieMap<void> is a plain set of words (see Trie below).
+// CharT is the alphabet: char and char8_t for bytes / UTF-8, char16_t and
+// char32_t for code units of wider encodings. All lookups take a
+// std::basic_string_view<CharT>, so strings, views and literals can be used
+// as keys without building a temporary string.
+template <typename V, typename CharT = char>
+class TrieMap {
+
+	struct NoValue {};
 
 	struct TrieNode {
-		std::map<char, TrieNode> children;
+		std::map<CharT, TrieNode> children;
+		[[no_unique_address]] std::conditional_t<std::is_void_v<V>, NoValue, std::optional<V>> value; // engaged when isWord is set
+		uint32_t weight{ 0 }; // score of the word, when isWord is set
+		uint32_t maxWeight{ 0 }; // the highest weight of all words in this subtree
 		bool isWord{ false };
 	};
 
 public:
+	using KeyView = std::basic_string_view<CharT>;
+	using Key = std::basic_string<CharT>;
+	using ValueRef = std::add_lvalue_reference_t<V>; // V& is ill-formed for word sets
 
-	Trie() = default;
-	Trie(std::initializer_list<std::string_view> words);
+	TrieMap() = default;
+	TrieMap(std::initializer_list<KeyView> words) requires std::is_void_v<V>;
 
 	size_t Size() const noexcept { return size; }
 	size_t NumNodes() const noexcept { return numNodes; }
+	size_t BytesUsed() const noexcept;
+
+	// Builds the whole trie in one pass over sorted words (unsorted input is sorted
+	// first): consecutive words share their common prefix path and every node is
+	// created once, appended at the end of its parent map. Subtrees for different
+	// first chars are built in parallel from ParallelBuildMin words on.
+	// The words only have to live during the call.
+	template <std::ranges::input_range TRange>
+	static TrieMap BulkBuild(const TRange& words) requires std::is_void_v<V>;
+	static TrieMap BulkBuild(std::vector<KeyView> words) requires std::is_void_v<V>;
+
+	void Insert(KeyView word) requires std::is_void_v<V>;
+
+	// inserts the word or updates its weight (frequency, score) used by TopK
+	void Insert(KeyView word, uint32_t weight) requires std::is_void_v<V>;
+
+	// Constructs the value from args if the key is not in the map yet,
+	// otherwise leaves it untouched. Returns the value and whether it was inserted.
+	template <typename... TArgs>
+	std::pair<V*, bool> try_emplace(KeyView key, TArgs&&... args) requires (!std::is_void_v<V>);
+
+	// inserts a value initialized entry when the key is missing
+	ValueRef operator[](KeyView key) requires (!std::is_void_v<V>) && std::default_initializable<V>;
 
-	void Insert(std::string_view word);
+	// nullptr when the key is not in the map
+	V* find(KeyView key) requires (!std::is_void_v<V>);
+	const V* find(KeyView key) const requires (!std::is_void_v<V>);
 
-	bool Find(std::string_view word) const;
+	bool Find(KeyView word) const;
 
-	bool Remove(std::string_view word);
+	bool Remove(KeyView word);
 
-	bool RemoveAndDeleteNodes(std::string_view word);
+	bool RemoveAndDeleteNodes(KeyView word);
+
+	std::vector<Key> Match(KeyView prefix) const;
+
+	// Streams all words starting with prefix to visitor, in sorted order, without
+	// building strings: the view points to an internal buffer that is reused
+	// for the next word. For maps the visitor can also take the value as a
+	// second argument. The visitor might return false to stop the enumeration.
+	// Returns the number of visited words.
+	template <typename TVisitor>
+	size_t ForEachMatch(KeyView prefix, TVisitor visitor, size_t maxResults = std::numeric_limits<size_t>::max()) const;
+
+	struct FuzzyResult {
+		Key word;
+		size_t distance{ 0 };
+	};
+
+	// All words within maxEdits Levenshtein distance from word, closest first.
+	// Keeps one DP row per trie level and skips subtrees once every entry in
+	// the row exceeds maxEdits.
+	std::vector<FuzzyResult> FuzzyMatch(KeyView word, size_t maxEdits) const;
+
+	struct WeightedResult {
+		Key word;
+		uint32_t weight{ 0 };
+	};
 
-	std::vector<std::string> Match(std::string_view prefix) const;
+	// k words with the highest weight starting with prefix, best first.
+	// Best-first search guided by the max weight cached in every node, so
+	// only the paths that lead to the results are expanded.
+	std::vector<WeightedResult> TopK(KeyView prefix, size_t k) const;
+
+	// writes a compact, pointer free image of the keys, see FrozenTrie
+	std::vector<char> Freeze() const requires std::same_as<CharT, char>;
+	void Freeze(const std::filesystem::path& path) const requires std::same_as<CharT, char>;
+
+private:
+	// template to deduce the constness, good idea according to
+	// https://isocpp.github.io/CppCoreGuidelines/CppCoreGuidelines#es50-dont-cast-away-const
+	template <typename T> requires std::is_same_v<TrieNode, std::remove_cv_t<T>>
+	static T* FindNode(KeyView word, T* pRoot);
+
+	const TrieNode* FindPrefixNode(KeyView prefix) const;
+
+	// the node for the word, created with its path when missing
+	TrieNode& InsertPath(KeyView word);
+
+	// refreshes maxWeight along the existing part of the path, bottom up
+	void UpdateMaxWeights(KeyView word);
+
+	struct BuildStats {
+		size_t numNodes{ 0 };
+		size_t numWords{ 0 };
+	};
+	static BuildStats BuildSortedSubtree(TrieNode& node, std::span<const KeyView> words, size_t depth);
+
+	// the order of the child maps, std::less<CharT>: for char that is signed, while
+	// the comparison of string views goes through char_traits and is unsigned
+	static bool KeyLess(KeyView a, KeyView b) noexcept {
+		return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), std::less<CharT>{});
+	}
+
+	static constexpr size_t ParallelBuildMin = 4096; // fewer words are built faster than the threads start
 
 private:
 	TrieNode root;
@@ -36,3 +161,523 @@ private:
 	size_t numNodes{ 0 }; // excluding root
 };
 
+using Trie = TrieMap<void>;
+
+template <typename V, typename CharT>
+TrieMap<V, CharT>::TrieMap(std::initializer_list<KeyView> words) requires std::is_void_v<V> : TrieMap(BulkBuild(words)) { }
+
+template <typename V, typename CharT>
+template <std::ranges::input_range TRange>
+TrieMap<V, CharT> TrieMap<V, CharT>::BulkBuild(const TRange& words) requires std::is_void_v<V> {
+	std::vector<KeyView> views;
+	if constexpr (std::ranges::sized_range<TRange>)
+		views.reserve(std::ranges::size(words));
+	for (const auto& w : words)
+		views.emplace_back(w);
+	return BulkBuild(std::move(views));
+}
+
+template <typename V, typename CharT>
+TrieMap<V, CharT> TrieMap<V, CharT>::BulkBuild(std::vector<KeyView> words) requires std::is_void_v<V> {
+	std::erase(words, KeyView{});
+	// only grouped by the first char here, every group is sorted by its own task
+	const bool sorted = std::is_sorted(words.begin(), words.end(), KeyLess);
+	if (!sorted)
+		std::sort(words.begin(), words.end(), [](KeyView a, KeyView b) { return std::less<CharT>{}(a.front(), b.front()); });
+
+	// words with the same first char are adjacent, each group gets its own subtree
+	std::vector<std::span<KeyView>> groups;
+	for (auto first = words.begin(); first != words.end(); ) {
+		const auto last = std::find_if(first, words.end(), [ch = first->front()](KeyView w) { return w.front() != ch; });
+		groups.emplace_back(first, last);
+		first = last;
+	}
+
+	std::vector<TrieNode> subtrees(groups.size());
+	std::vector<BuildStats> stats(groups.size());
+	const auto buildGroup = [&groups, &subtrees, &stats, sorted](size_t i) {
+		if (!sorted)
+			std::sort(groups[i].begin(), groups[i].end(), KeyLess);
+		stats[i] = BuildSortedSubtree(subtrees[i], groups[i], 1);
+	};
+	if (words.size() < ParallelBuildMin) {
+		for (size_t i = 0; i < groups.size(); ++i)
+			buildGroup(i);
+	}
+	else
+		trie_detail::ParallelFor(groups.size(), buildGroup);
+
+	TrieMap trie;
+	for (size_t i = 0; i < groups.size(); ++i) {
+		trie.root.children.emplace_hint(trie.root.children.end(), groups[i].front().front(), std::move(subtrees[i]));
+		trie.numNodes += stats[i].numNodes + 1;
+		trie.size += stats[i].numWords;
+	}
+
+	return trie;
+}
+
+// all words are sorted and share the first depth chars, node represents that prefix
+template <typename V, typename CharT>
+typename TrieMap<V, CharT>::BuildStats TrieMap<V, CharT>::BuildSortedSubtree(TrieNode& node, std::span<const KeyView> words, size_t depth) {
+	BuildStats stats;
+
+	// path[i] is the node for the first depth + i chars of the previous word
+	std::vector<TrieNode*> path{ &node };
+	KeyView prev = words.front().substr(0, depth);
+	for (const auto& word : words) {
+		const auto len = std::min(prev.size(), word.size());
+		const auto common = static_cast<size_t>(std::mismatch(prev.begin() + depth, prev.begin() + len, word.begin() + depth).first - prev.begin());
+
+		path.resize(common - depth + 1);
+		for (size_t i = common; i < word.size(); ++i) {
+			auto& children = path.back()->children;
+			path.push_back(&children.emplace_hint(children.end(), word[i], TrieNode{})->second);
+			++stats.numNodes;
+		}
+
+		if (!path.back()->isWord) {
+			path.back()->isWord = true;
+			++stats.numWords;
+		}
+		prev = word;
+	}
+
+	return stats;
+}
+
+template <typename V, typename CharT>
+size_t TrieMap<V, CharT>::BytesUsed() const noexcept {
+	// estimation: every child is a separate std::map allocation,
+	// a tree node holds three pointers and a color flag next to the value
+	constexpr size_t mapNodeOverhead = 4 * sizeof(void*);
+	return sizeof(*this) + numNodes * (sizeof(typename std::map<CharT, TrieNode>::value_type) + mapNodeOverhead);
+}
+
+template <typename V, typename CharT>
+void TrieMap<V, CharT>::Insert(KeyView word) requires std::is_void_v<V> {
+	if (word.empty())
+		return;
+
+	auto& node = InsertPath(word);
+	if (!node.isWord) {
+		node.isWord = true;
+		node.weight = 0;
+		++size;
+	}
+}
+
+template <typename V, typename CharT>
+void TrieMap<V, CharT>::Insert(KeyView word, uint32_t weight) requires std::is_void_v<V> {
+	if (word.empty())
+		return;
+
+	TrieNode* pNode = &root;
+	pNode->maxWeight = std::max(pNode->maxWeight, weight);
+	for (const auto& ch : word) {
+		const auto [iter, wasInserted] = pNode->children.try_emplace(ch);
+		pNode = &iter->second;
+		pNode->maxWeight = std::max(pNode->maxWeight, weight);
+		if (wasInserted)
+			++numNodes;
+	}
+
+	if (!pNode->isWord) {
+		pNode->isWord = true;
+		++size;
+	}
+
+	const bool lowered = weight < pNode->weight;
+	pNode->weight = weight;
+	if (lowered)
+		UpdateMaxWeights(word);
+}
+
+template <typename V, typename CharT>
+template <typename... TArgs>
+std::pair<V*, bool> TrieMap<V, CharT>::try_emplace(KeyView key, TArgs&&... args) requires (!std::is_void_v<V>) {
+	if (key.empty())
+		throw std::invalid_argument("TrieMap keys cannot be empty");
+
+	auto& node = InsertPath(key);
+	if (node.isWord)
+		return { &*node.value, false };
+
+	node.value.emplace(std::forward<TArgs>(args)...);
+	node.isWord = true;
+	node.weight = 0;
+	++size;
+	return { &*node.value, true };
+}
+
+template <typename V, typename CharT>
+typename TrieMap<V, CharT>::ValueRef TrieMap<V, CharT>::operator[](KeyView key) requires (!std::is_void_v<V>) && std::default_initializable<V> {
+	return *try_emplace(key).first;
+}
+
+template <typename V, typename CharT>
+V* TrieMap<V, CharT>::find(KeyView key) requires (!std::is_void_v<V>) {
+	auto pNode = FindNode(key, &root);
+	return pNode && pNode->isWord ? &*pNode->value : nullptr;
+}
+
+template <typename V, typename CharT>
+const V* TrieMap<V, CharT>::find(KeyView key) const requires (!std::is_void_v<V>) {
+	auto pNode = FindNode(key, &root);
+	return pNode && pNode->isWord ? &*pNode->value : nullptr;
+}
+
+template <typename V, typename CharT>
+bool TrieMap<V, CharT>::Find(KeyView word) const {
+	auto pNode = FindNode(word, &root);
+	return pNode ? pNode->isWord : false;
+}
+
+template <typename V, typename CharT>
+bool TrieMap<V, CharT>::Remove(KeyView word) {
+	auto pNode = FindNode(word, &root);
+	if (pNode && pNode->isWord) {
+		pNode->isWord = false;
+		if constexpr (!std::is_void_v<V>)
+			pNode->value.reset();
+		--size;
+		if (pNode->weight > 0) {
+			pNode->weight = 0;
+			UpdateMaxWeights(word);
+		}
+		return true;
+	}
+	return false;
+}
+
+template <typename V, typename CharT>
+bool TrieMap<V, CharT>::RemoveAndDeleteNodes(KeyView word) {
+	if (word.empty())
+		return false;
+
+	// the nodes after pDeleteFrom, down to the end of the word, belong only to this word:
+	// it is moved down to every node that branches or is a word itself
+	auto pNode = &root;
+	TrieNode* pDeleteFrom = &root;
+	CharT firstCharToDelete = word[0];
+	size_t nodesToDelete = 0;
+	for (const auto& ch : word) {
+		const auto it = pNode->children.find(ch);
+		if (it == pNode->children.end())
+			return false;
+
+		if (pNode == &root || pNode->children.size() > 1 || pNode->isWord) {
+			pDeleteFrom = pNode;
+			firstCharToDelete = ch;
+			nodesToDelete = 1;
+		}
+		else
+			++nodesToDelete;
+
+		pNode = &(it->second);
+	}
+
+	if (!pNode->isWord)
+		return false;
+
+	// a prefix of other words, only the word mark goes
+	if (!pNode->children.empty())
+		return Remove(word);
+
+	pDeleteFrom->children.erase(firstCharToDelete);
+	--size;
+	numNodes -= nodesToDelete;
+	UpdateMaxWeights(word);
+	return true;
+}
+
+template <typename V, typename CharT>
+std::vector<typename TrieMap<V, CharT>::Key> TrieMap<V, CharT>::Match(KeyView prefix) const {
+	std::vector<Key> out;
+	ForEachMatch(prefix, [&out](KeyView word) { out.emplace_back(word); });
+	return out;
+}
+
+template <typename V, typename CharT>
+template <typename TVisitor>
+size_t TrieMap<V, CharT>::ForEachMatch(KeyView prefix, TVisitor visitor, size_t maxResults) const {
+	auto pNode = FindPrefixNode(prefix);
+	if (!pNode || maxResults == 0)
+		return 0;
+
+	size_t count = 0;
+	Key word{ prefix };
+
+	const auto invoke = [&visitor, &word]([[maybe_unused]] const TrieNode& node) {
+		if constexpr (std::is_void_v<V>)
+			return visitor(KeyView{ word });
+		else if constexpr (std::is_invocable_v<TVisitor&, KeyView, const V&>)
+			return visitor(KeyView{ word }, *node.value);
+		else
+			return visitor(KeyView{ word });
+	};
+
+	// returns false when the enumeration should stop
+	const auto visit = [&invoke, &count, maxResults](const TrieNode& node) {
+		++count;
+		if constexpr (std::is_void_v<decltype(invoke(node))>) {
+			invoke(node);
+			return count < maxResults;
+		}
+		else
+			return invoke(node) && count < maxResults;
+	};
+
+	if (pNode->isWord && !visit(*pNode))
+		return count;
+
+	// one frame per level, so the memory is proportional to the depth, not to the number of words
+	struct Frame {
+		typename std::map<CharT, TrieNode>::const_iterator it;
+		typename std::map<CharT, TrieNode>::const_iterator end;
+	};
+	std::vector<Frame> stack{ { pNode->children.begin(), pNode->children.end() } };
+
+	while (!stack.empty()) {
+		auto& top = stack.back();
+		if (top.it == top.end) {
+			stack.pop_back();
+			if (!stack.empty())
+				word.pop_back();
+			continue;
+		}
+
+		const auto& [ch, child] = *top.it++;
+		word.push_back(ch);
+		if (child.isWord && !visit(child))
+			break;
+
+		stack.push_back({ child.children.begin(), child.children.end() });
+	}
+
+	return count;
+}
+
+template <typename V, typename CharT>
+std::vector<typename TrieMap<V, CharT>::FuzzyResult> TrieMap<V, CharT>::FuzzyMatch(KeyView word, size_t maxEdits) const {
+	std::vector<FuzzyResult> out;
+
+	// rows[depth * cols + i] is the distance between the current trie word
+	// (depth chars) and the first i chars of word
+	const size_t cols = word.size() + 1;
+	std::vector<size_t> rows(cols);
+	std::iota(rows.begin(), rows.end(), 0);
+
+	struct Frame {
+		typename std::map<CharT, TrieNode>::const_iterator it;
+		typename std::map<CharT, TrieNode>::const_iterator end;
+	};
+	std::vector<Frame> stack{ { root.children.begin(), root.children.end() } };
+	Key current;
+
+	while (!stack.empty()) {
+		auto& top = stack.back();
+		if (top.it == top.end) {
+			stack.pop_back();
+			if (!stack.empty())
+				current.pop_back();
+			continue;
+		}
+
+		const auto& [ch, child] = *top.it++;
+		current.push_back(ch);
+
+		const auto depth = current.size();
+		rows.resize((depth + 1) * cols);
+		const auto prevRow = rows.begin() + (depth - 1) * cols;
+		const auto row = rows.begin() + depth * cols;
+
+		row[0] = depth;
+		size_t rowMin = row[0];
+		for (size_t i = 1; i < cols; ++i) {
+			row[i] = std::min({ prevRow[i] + 1, row[i - 1] + 1, prevRow[i - 1] + (word[i - 1] == ch ? 0 : 1) });
+			rowMin = std::min(rowMin, row[i]);
+		}
+
+		if (child.isWord && row[cols - 1] <= maxEdits)
+			out.push_back({ current, row[cols - 1] });
+
+		// no completion can get closer than the best entry in the row
+		if (rowMin <= maxEdits)
+			stack.push_back({ child.children.begin(), child.children.end() });
+		else
+			current.pop_back();
+	}
+
+	std::ranges::stable_sort(out, {}, &FuzzyResult::distance);
+	return out;
+}
+
+template <typename V, typename CharT>
+std::vector<typename TrieMap<V, CharT>::WeightedResult> TrieMap<V, CharT>::TopK(KeyView prefix, size_t k) const {
+	std::vector<WeightedResult> out;
+
+	auto pStart = FindPrefixNode(prefix);
+	if (!pStart || k == 0)
+		return out;
+
+	// words are rebuilt only for the results, from (parent, char) links
+	struct PathLink {
+		size_t parent;
+		CharT ch;
+	};
+	std::vector<PathLink> links{ { 0, CharT{} } };
+
+	// a node is queued with the best weight in its subtree, a word with its own
+	// weight; on ties words go first, as they can't be beaten by their subtree
+	struct Candidate {
+		uint32_t priority;
+		bool isWord;
+		size_t link;
+		const TrieNode* pNode;
+
+		bool operator<(const Candidate& other) const {
+			return std::tie(priority, isWord) < std::tie(other.priority, other.isWord);
+		}
+	};
+	std::priority_queue<Candidate> queue;
+	queue.push({ pStart->maxWeight, false, 0, pStart });
+
+	Key word;
+	while (!queue.empty() && out.size() < k) {
+		const auto candidate = queue.top();
+		queue.pop();
+
+		if (candidate.isWord) {
+			word.clear();
+			for (auto link = candidate.link; link != 0; link = links[link].parent)
+				word.push_back(links[link].ch);
+			word.append(prefix.rbegin(), prefix.rend());
+			out.push_back({ { word.rbegin(), word.rend() }, candidate.priority });
+			continue;
+		}
+
+		const auto pNode = candidate.pNode;
+		if (pNode->isWord)
+			queue.push({ pNode->weight, true, candidate.link, pNode });
+
+		for (const auto& [ch, child] : pNode->children) {
+			if (child.isWord || !child.children.empty()) {
+				links.push_back({ candidate.link, ch });
+				queue.push({ child.maxWeight, false, links.size() - 1, &child });
+			}
+		}
+	}
+
+	return out;
+}
+
+template <typename V, typename CharT>
+std::vector<char> TrieMap<V, CharT>::Freeze() const requires std::same_as<CharT, char> {
+	const auto totalNodes = numNodes + 1;
+	if (totalNodes >= std::numeric_limits<uint32_t>::max())
+		throw std::runtime_error("Trie is too large to freeze");
+
+	std::vector<char> image(frozen::ImageSize(totalNodes));
+
+	frozen::Header header{};
+	std::memcpy(header.magic, frozen::Magic, sizeof(frozen::Magic));
+	header.version = frozen::Version;
+	header.numNodes = static_cast<uint32_t>(totalNodes);
+	header.numWords = size;
+	std::memcpy(image.data(), &header, sizeof(header));
+
+	const auto pNodes = image.data() + sizeof(frozen::Header);
+	const auto pLabels = pNodes + totalNodes * sizeof(frozen::Node);
+
+	// level order, so the children of every node get consecutive indices
+	std::vector<const TrieNode*> queue{ &root };
+	queue.reserve(totalNodes);
+	pLabels[0] = '\0';
+	for (size_t i = 0; i < queue.size(); ++i) {
+		const auto pNode = queue[i];
+		const frozen::Node node{
+			static_cast<uint32_t>(queue.size()),
+			static_cast<uint16_t>(pNode->children.size()),
+			static_cast<uint8_t>(pNode->isWord ? 1 : 0),
+			0
+		};
+		std::memcpy(pNodes + i * sizeof(frozen::Node), &node, sizeof(node));
+
+		for (const auto& [ch, child] : pNode->children) {
+			pLabels[queue.size()] = ch;
+			queue.push_back(&child);
+		}
+	}
+
+	return image;
+}
+
+template <typename V, typename CharT>
+void TrieMap<V, CharT>::Freeze(const std::filesystem::path& path) const requires std::same_as<CharT, char> {
+	const auto image = Freeze();
+
+	std::ofstream outFile{ path, std::ios::out | std::ios::binary };
+	if (!outFile)
+		throw std::runtime_error("Cannot open " + path.filename().string());
+
+	outFile.write(image.data(), image.size());
+	if (!outFile)
+		throw std::runtime_error("Could not write the image to " + path.filename().string());
+}
+
+template <typename V, typename CharT>
+template <typename T> requires std::is_same_v<typename TrieMap<V, CharT>::TrieNode, std::remove_cv_t<T>>
+T* TrieMap<V, CharT>::FindNode(KeyView word, T* pRoot) {
+	if (word.empty())
+		return nullptr;
+
+	auto pNode = pRoot;
+	for (const auto& ch : word) {
+		const auto it = pNode->children.find(ch);
+		if (it == pNode->children.end())
+			return nullptr;
+
+		pNode = &(it->second);
+	}
+
+	return pNode;
+}
+
+template <typename V, typename CharT>
+const typename TrieMap<V, CharT>::TrieNode* TrieMap<V, CharT>::FindPrefixNode(KeyView prefix) const {
+	return prefix.empty() ? &root : FindNode(prefix, &root);
+}
+
+template <typename V, typename CharT>
+typename TrieMap<V, CharT>::TrieNode& TrieMap<V, CharT>::InsertPath(KeyView word) {
+	TrieNode* pNode = &root;
+	for (const auto& ch : word) {
+		const auto [iter, wasInserted] = pNode->children.try_emplace(ch);
+		pNode = &iter->second;
+		if (wasInserted)
+			++numNodes;
+	}
+	return *pNode;
+}
+
+template <typename V, typename CharT>
+void TrieMap<V, CharT>::UpdateMaxWeights(KeyView word) {
+	std::vector<TrieNode*> path{ &root };
+	for (const auto& ch : word) {
+		const auto it = path.back()->children.find(ch);
+		if (it == path.back()->children.end())
+			break;
+		path.push_back(&it->second);
+	}
+
+	for (auto it = path.rbegin(); it != path.rend(); ++it) {
+		auto pNode = *it;
+		pNode->maxWeight = pNode->isWord ? pNode->weight : 0;
+		for (const auto& [ch, child] : pNode->children)
+			pNode->maxWeight = std::max(pNode->maxWeight, child.maxWeight);
+	}
+}
+
+// compiled once in trie.cpp
+extern template class TrieMap<void, char>;